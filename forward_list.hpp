@@ -34,13 +34,22 @@ namespace jsonserial {
     T& cont_;
     typename T::iterator pos_;
     
-    JsonArrayImpl(T& cont) : cont_(cont) {cont_.clear(); pos_ = cont_.before_begin();}
+    JsonArrayImpl(T& cont) : cont_(cont) {}
+    
+    void begin(JsonSerial& js) override {
+      if (!js.reuse_ && !js.patching_) cont_.clear();
+      pos_ = cont_.before_begin();
+    }
     
     void add(JsonSerial& js, MetaClass::Creator* cr, const std::string& s) override {
-      typename T::value_type val;
+      auto next = std::next(pos_);
+      pos_ = (next != cont_.end()) ? next : cont_.emplace_after(pos_);
       ObjectPtr* objptr{nullptr};
-      readArrayValue(js, val, objptr, cr, s);
-      pos_= cont_.insert_after(pos_, val);
+      readArrayValue(js, *pos_, objptr, cr, s);
+    }
+    
+    void end(JsonSerial& js) override {
+      if (!js.patching_) cont_.erase_after(pos_, cont_.end());   // extra elements (reuse mode)
     }
   };
   
@@ -0,0 +1,83 @@
+//
+//  internedstring.hpp: must be included for using InternedString members
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_internedstring_hpp
+#define jsonserial_internedstring_hpp
+
+namespace jsonserial {
+
+  /** Immutable string stored in a JsonStringBuffer.
+   * An InternedString is just a pointer to a string stored in the JsonStringBuffer
+   * of the JsonSerial that read it (see JsonSerial::setStringBuffer()).
+   * If the buffer was created with interning on, identical values share the same
+   * storage. This is useful for values that are repeated many times (e.g. "home"
+   * or "work" for phone number types).
+   * The string remains valid as long as the JsonStringBuffer exists.
+   */
+  class InternedString {
+  public:
+    InternedString() = default;
+
+    /// _s_ must remain valid as long as this InternedString is used.
+    explicit InternedString(const char* s) : str_(s ? s : "") {}
+
+    const char* c_str() const {return str_;}
+    std::string str() const {return str_;}
+    operator std::string() const {return str_;}
+    size_t length() const {return ::strlen(str_);}
+    bool empty() const {return *str_ == 0;}
+
+    bool operator==(const InternedString& s) const {return str_ == s.str_ || ::strcmp(str_, s.str_) == 0;}
+    bool operator!=(const InternedString& s) const {return !(*this == s);}
+    bool operator==(const char* s) const {return ::strcmp(str_, s) == 0;}
+    bool operator!=(const char* s) const {return ::strcmp(str_, s) != 0;}
+
+    // - - - called by JsonSerial
+
+    void readJson(JsonSerial& js, const std::string& s) {
+      if (!isString(js, s)) js.error(JsonError::InvalidValue, s+" should be a string");
+      else if (!js.strings_) js.error(JsonError::NoStringBuffer);
+      else str_ = js.strings_->store(s);
+    }
+
+    void writeJson(JsonSerial& js) const {js.writeString(str_, false);}
+
+    static bool validateJson(JsonSerial& js, const std::string& s) {
+      return validateScalar(js, s) && isString(js, s);
+    }
+
+  private:
+    // quoted strings and unquoted strings (if allowed by the syntax) but not
+    // null, booleans, numbers, objects or arrays.
+    static bool isString(JsonSerial& js, const std::string& s) {
+      JsonSerial::TokenType type = js.tokenType(s);
+      return type == JsonSerial::StringToken || type == JsonSerial::OtherToken;
+    }
+
+    const char* str_{""};
+  };
+
+  template <>
+  struct has_custom_format<InternedString> : std::true_type {};
+
+}
+
+#endif
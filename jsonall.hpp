@@ -26,8 +26,14 @@
 #include <jsonserial/array.hpp>
 #include <jsonserial/deque.hpp>
 #include <jsonserial/forward_list.hpp>
+#include <jsonserial/internedstring.hpp>
+#include <jsonserial/jsonbatch.hpp>
+#include <jsonserial/jsondelta.hpp>
+#include <jsonserial/jsonjournal.hpp>
+#include <jsonserial/lazy.hpp>
 #include <jsonserial/list.hpp>
 #include <jsonserial/map.hpp>
+#include <jsonserial/rawjson.hpp>
 #include <jsonserial/set.hpp>
 #include <jsonserial/unordered_map.hpp>
 #include <jsonserial/unordered_set.hpp>
@@ -0,0 +1,158 @@
+//
+//  jsonarena.hpp (included by jsonserial.hpp)
+//  Memory arena for the objects created when reading JSON data.
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonarena_hpp
+#define jsonarena_hpp
+
+namespace jsonserial {
+
+  /** Memory arena for the objects that are created when reading JSON data.
+   *  Objects are allocated in large memory blocks instead of being allocated one
+   *  by one. They are all destroyed (in reverse order of creation) and freed
+   *  at once when the arena is destroyed or cleared.
+   *  @see JsonSerial::setArena().
+   */
+  class JsonArena {
+  public:
+    /// _blocksize_ is the size of the memory blocks that are allocated.
+    JsonArena(size_t blocksize = 64*1024) : blocksize_(blocksize) {}
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+
+    ~JsonArena() {clear();}
+
+    /// Destroys all objects and frees memory.
+    void clear() {
+      for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) (it->fun_)(it->obj_);
+      destructors_.clear();
+      blocks_.clear();
+      cur_ = end_ = nullptr;
+    }
+
+    /// Allocates uninitialized memory.
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+      if (size + align > blocksize_ / 4) {  // big object: allocated separately
+        blocks_.push_front(Block{std::unique_ptr<char[]>(new char[size + align]), size + align});
+        return alignPtr(blocks_.front().data_.get(), align);
+      }
+      char* p = cur_ ? alignPtr(cur_, align) : nullptr;
+      if (!p || p > end_ || size_t(end_ - p) < size) {
+        blocks_.push_back(Block{std::unique_ptr<char[]>(new char[blocksize_]), blocksize_});
+        end_ = blocks_.back().data_.get() + blocksize_;
+        p = alignPtr(blocks_.back().data_.get(), align);
+      }
+      cur_ = p + size;
+      return p;
+    }
+
+    /// Creates an object that will be destroyed with the arena.
+    template <class T, class... Args>
+    T* create(Args&&... args) {
+      T* obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      if (!std::is_trivially_destructible<T>::value) destructors_.push_back({destroy<T>, obj});
+      return obj;
+    }
+
+    /// Takes ownership of an object created by new: it will be deleted with the arena.
+    template <class T>
+    T* adopt(T* obj) {
+      if (obj) destructors_.push_back({dispose<T>, obj});
+      return obj;
+    }
+
+    /// Copies a string in the arena.
+    char* copyString(const std::string& s) {
+      char* p = static_cast<char*>(allocate(s.size() + 1, 1));
+      ::memcpy(p, s.c_str(), s.size() + 1);
+      return p;
+    }
+
+    /// Returns the number of allocated blocks.
+    size_t blockCount() const {return blocks_.size();}
+    
+    /// Returns true if _p_ points to memory allocated by this arena.
+    bool contains(const void* p) const {
+      uintptr_t n = reinterpret_cast<uintptr_t>(p);
+      for (auto& b : blocks_) {
+        uintptr_t data = reinterpret_cast<uintptr_t>(b.data_.get());
+        if (n >= data && n - data < b.size_) return true;
+      }
+      return false;
+    }
+
+  private:
+    template <class T> static void destroy(void* obj) {static_cast<T*>(obj)->~T();}
+    template <class T> static void dispose(void* obj) {delete static_cast<T*>(obj);}
+
+    static char* alignPtr(char* p, size_t align) {
+      uintptr_t n = reinterpret_cast<uintptr_t>(p);
+      return p + (align - n % align) % align;
+    }
+
+    struct Block {
+      std::unique_ptr<char[]> data_;
+      size_t size_;
+    };
+    
+    struct Destructor {
+      void (*fun_)(void*);
+      void* obj_;
+    };
+
+    size_t blocksize_;
+    char *cur_{nullptr}, *end_{nullptr};
+    std::list<Block> blocks_;
+    std::vector<Destructor> destructors_;
+  };
+
+  /** Allocator that allocates memory in an arena (for std::allocate_shared()).
+   *  Memory is freed with the arena. The allocator does not own the arena (otherwise
+   *  objects created in the arena that contain shared_ptrs would keep it alive forever):
+   *  the arena must outlive the objects.
+   */
+  template <class T>
+  struct JsonArenaAllocator {
+    using value_type = T;
+    JsonArena* arena_;
+
+    JsonArenaAllocator(JsonArena* arena) : arena_(arena) {}
+    template <class U> JsonArenaAllocator(const JsonArenaAllocator<U>& a) : arena_(a.arena_) {}
+
+    T* allocate(size_t n) {return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));}
+    void deallocate(T*, size_t) {}
+
+    template <class U> bool operator==(const JsonArenaAllocator<U>& a) const {return arena_ == a.arena_;}
+    template <class U> bool operator!=(const JsonArenaAllocator<U>& a) const {return arena_ != a.arena_;}
+  };
+
+  /** Deleter of the shared_ptrs that point to objects created in an arena.
+   *  Does nothing: objects are destroyed by the arena, which must outlive them.
+   */
+  struct JsonArenaRef {
+    JsonArena* arena_;
+    void operator()(const void*) const {}
+  };
+
+}
+
+#endif
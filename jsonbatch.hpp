@@ -0,0 +1,104 @@
+//
+//  jsonbatch.hpp: must be included for serializing many objects in parallel
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_jsonbatch_hpp
+#define jsonserial_jsonbatch_hpp
+
+namespace jsonserial {
+
+  /** Serializes many independent objects in parallel.
+   * write() serializes each object in a separate string, using the threads of a
+   * JsonThreadPool. Each thread reuses its own JsonSerial, all of them share the
+   * same JsonClasses (which must not be modified meanwhile).
+   * The options of these JsonSerials (e.g. setSharing()) are those of options(),
+   * which must not be modified while write() is executing. write() can be called
+   * by several threads at the same time: the calls are then executed one at a time.
+   *
+   * Example:
+   * @code
+   *   JsonBatchWriter writer(classes);
+   *   std::vector<const Contact*> contacts = ...;
+   *   std::vector<std::string> results = writer.write(contacts.data(), contacts.size());
+   * @endcode
+   */
+  class JsonBatchWriter {
+  public:
+    /// Uses a pool of _threads_ threads (one per core if _threads_ is 0).
+    JsonBatchWriter(const JsonClasses& classes, size_t threads = 0)
+    : own_pool_(new JsonThreadPool(threads)), pool_(*own_pool_), options_(classes) {init();}
+
+    /// Uses the threads of _pool_.
+    JsonBatchWriter(const JsonClasses& classes, JsonThreadPool& pool)
+    : pool_(pool), options_(classes) {init();}
+
+    JsonBatchWriter(const JsonBatchWriter&) = delete;
+    JsonBatchWriter& operator=(const JsonBatchWriter&) = delete;
+
+    /// Returns the JsonSerial whose options are used for writing.
+    JsonSerial& options() {return options_;}
+
+    /** Serializes _count_ objects in parallel.
+     *  Returns the JSON text of each object, in the same order as _objects_
+     *  (an empty string if an error occurred). If _errors_ is not null, it is set
+     *  to the outcome of each object: the type of the JsonError is JsonError::OK
+     *  if there was no error. Errors are not printed and the error handler is not called.
+     */
+    template <class T>
+    std::vector<std::string> write(const T* const* objects, size_t count,
+                                   std::vector<JsonError>* errors = nullptr) {
+      std::vector<std::string> results(count);
+      if (errors) errors->assign(count, JsonError());
+      unsigned long call = ++calls_;
+      pool_.run(count, [this, objects, errors, &results, call](size_t k) {
+        Worker& w = *workers_[JsonThreadPool::workerIndex()];
+        // the settings are applied inside run(), which runs one job at a time,
+        // so that concurrent calls don't change the JsonSerials of the workers meanwhile
+        if (w.call_ != call) {w.js_.copySettings(options_); w.call_ = call;}
+        w.buf_.str("");
+        if (w.js_.write(*objects[k], w.buf_)) results[k] = w.buf_.str();
+        else if (errors && w.js_.getError()) (*errors)[k] = *w.js_.getError();
+      });
+      return results;
+    }
+
+  private:
+    struct Worker {
+      Worker(const JsonClasses& classes) : js_(classes, [](const JsonError&) {}) {}
+      JsonSerial js_;
+      std::ostringstream buf_;
+      unsigned long call_{0};   // last write() call (see write())
+    };
+
+    void init() {
+      for (size_t k = 0; k < pool_.size(); ++k)
+        workers_.emplace_back(new Worker(options_.getClasses()));
+    }
+
+    std::unique_ptr<JsonThreadPool> own_pool_;
+    JsonThreadPool& pool_;
+    JsonSerial options_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<unsigned long> calls_{0};
+  };
+
+}
+
+#endif
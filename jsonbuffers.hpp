@@ -0,0 +1,494 @@
+//
+//  jsonbuffers.hpp (included by jsonserial.hpp)
+//  Buffers used for reading and writing JSON data.
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonbuffers_hpp
+#define jsonbuffers_hpp
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define JSONSERIAL_POSIX 1
+#endif
+
+namespace jsonserial {
+
+  /** Input stream buffer that reads JSON data from memory without copying it.
+   *  Unlike std::istringstream, the data is not copied: it must remain valid
+   *  while it is being read (e.g. a memory-mapped file).
+   *  Example:
+   *  @code
+   *   JsonInputBuffer buf(data, size);
+   *   std::istream in(&buf);
+   *   js.read(obj, in);
+   *  @endcode
+   */
+  class JsonInputBuffer : public std::streambuf {
+  public:
+    JsonInputBuffer(const char* data, size_t size) {
+      char* p = const_cast<char*>(data);   // never written
+      setg(p, p, p + size);
+    }
+    
+  protected:
+    pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) override {
+      char* p = (dir == std::ios::beg) ? eback() : (dir == std::ios::end) ? egptr() : gptr();
+      if (!(which & std::ios::in) || off < eback() - p || off > egptr() - p) return pos_type(-1);
+      setg(eback(), p + off, egptr());
+      return pos_type(gptr() - eback());
+    }
+    
+    pos_type seekpos(pos_type pos, std::ios::openmode which) override {
+      return seekoff(off_type(pos), std::ios::beg, which);
+    }
+  };
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  /** Input stream buffer that reads data in advance in another thread.
+   *  Data is read by blocks in two buffers: a thread fills one buffer while the other
+   *  one is being parsed, so that parsing overlaps with I/O latency. This is useful
+   *  for large files on slow (e.g. network) file systems.
+   *
+   *  The data can be read from a file (using pread() on POSIX systems) or from another
+   *  stream buffer. In the latter case, this buffer reads _source_ beyond the
+   *  end of the JSON data, and _source_ must not be used until this buffer is destroyed.
+   *  Example:
+   *  @code
+   *   JsonReadAheadBuffer buf(in.rdbuf());
+   *   std::istream input(&buf);
+   *   js.read(obj, input);
+   *  @endcode
+   *  @see JsonSerial::setReadAhead() for reading files.
+   */
+  class JsonReadAheadBuffer : public std::streambuf {
+  public:
+    /// Reads the file _filename_ by blocks of _blocksize_ bytes.
+    JsonReadAheadBuffer(const std::string& filename, size_t blocksize = 1024*1024)
+    : blocksize_(blocksize) {
+#if JSONSERIAL_POSIX
+      fd_ = ::open(filename.c_str(), O_RDONLY);
+      if (fd_ < 0) return;
+#ifdef POSIX_FADV_SEQUENTIAL
+      ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+      if (!file_.open(filename, std::ios::in | std::ios::binary)) return;
+      source_ = &file_;
+#endif
+      start();
+    }
+
+    /// Reads _source_ by blocks of _blocksize_ bytes.
+    JsonReadAheadBuffer(std::streambuf* source, size_t blocksize = 1024*1024)
+    : source_(source), blocksize_(blocksize) {
+      if (source_) start();
+    }
+
+    JsonReadAheadBuffer(const JsonReadAheadBuffer&) = delete;
+    JsonReadAheadBuffer& operator=(const JsonReadAheadBuffer&) = delete;
+
+    ~JsonReadAheadBuffer() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cond_.notify_all();
+      if (thread_.joinable()) thread_.join();
+#if JSONSERIAL_POSIX
+      if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    /// Returns true if the data source could be opened.
+    bool isOpen() const {return thread_.joinable();}
+
+    /// Returns true if an I/O error occurred (the data then appears to be truncated).
+    bool hasFailed() const {return failed_;}
+
+  protected:
+    // only returns the current position (the data can't be read again).
+    pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) override {
+      if (off != 0 || dir != std::ios::cur || !(which & std::ios::in)) return pos_type(-1);
+      return pos_type(off_type(consumed_ + (gptr() - eback())));
+    }
+    
+    int_type underflow() override {
+      if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+      if (!isOpen()) return traits_type::eof();
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (current_ >= 0) {   // the current block has been parsed
+        consumed_ += blocks_[current_].size_;
+        blocks_[current_].full_ = false;
+        current_ = -1;
+        cond_.notify_all();
+      }
+      Block& b = blocks_[next_];
+      cond_.wait(lock, [&b]{return b.full_;});
+      if (b.size_ == 0) return traits_type::eof();   // stays full: end of data
+      current_ = next_;
+      next_ = 1 - next_;
+      setg(b.data_.get(), b.data_.get(), b.data_.get() + b.size_);
+      return traits_type::to_int_type(*gptr());
+    }
+
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data_;
+      size_t size_{0};
+      bool full_{false};
+    };
+
+    void start() {
+      for (auto& b : blocks_) b.data_.reset(new char[blocksize_]);
+      thread_ = std::thread(&JsonReadAheadBuffer::fill, this);
+    }
+
+    // fills the blocks alternately (in the read-ahead thread).
+    void fill() {
+      for (int k = 0; ; k = 1 - k) {
+        Block& b = blocks_[k];
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cond_.wait(lock, [this, &b]{return stop_ || !b.full_;});
+          if (stop_) return;
+        }
+        size_t size = readSource(b.data_.get());
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          b.size_ = size;
+          b.full_ = true;
+        }
+        cond_.notify_all();
+        if (size == 0) return;
+      }
+    }
+
+    size_t readSource(char* data) {
+      size_t size = 0;
+#if JSONSERIAL_POSIX
+      if (fd_ >= 0) {
+        while (size < blocksize_) {
+          ssize_t n = ::pread(fd_, data + size, blocksize_ - size, offset_);
+          if (n < 0 && errno == EINTR) continue;
+          if (n < 0) failed_ = true;
+          if (n <= 0) break;
+          size += size_t(n);
+          offset_ += n;
+        }
+        return size;
+      }
+#endif
+      std::streamsize n = source_->sgetn(data, std::streamsize(blocksize_));
+      return n > 0 ? size_t(n) : 0;
+    }
+
+    std::streambuf* source_{nullptr};
+#if JSONSERIAL_POSIX
+    int fd_{-1};
+    off_t offset_{0};
+#else
+    std::filebuf file_;
+#endif
+    size_t blocksize_;
+    Block blocks_[2];
+    int current_{-1}, next_{0};
+    size_t consumed_{0};   // size of the blocks that have been parsed
+    std::atomic<bool> failed_{false};
+    bool stop_{false};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;
+  };
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  /** Output stream buffer that writes data in another thread.
+   *  Data is formatted in memory blocks that are written (and finally synced to disk)
+   *  by another thread, so that formatting overlaps with disk latency. Memory usage
+   *  is bounded: when all blocks are waiting to be written, formatting waits for the
+   *  writing thread.
+   *
+   *  The data can be written to a file (using write() and fsync() on POSIX systems)
+   *  or to another stream buffer. close() must be called to know whether
+   *  all data could be written.
+   *  @see JsonSerial::setWriteBehind() for writing files.
+   */
+  class JsonWriteBehindBuffer : public std::streambuf {
+  public:
+    /// Writes the file _filename_ using _blockcount_ blocks of _blocksize_ bytes.
+    JsonWriteBehindBuffer(const std::string& filename, size_t blocksize = 1024*1024,
+                          size_t blockcount = 4)
+    : blocksize_(blocksize) {
+#if JSONSERIAL_POSIX
+      fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd_ < 0) return;
+#else
+      if (!file_.open(filename, std::ios::out | std::ios::binary)) return;
+      dest_ = &file_;
+#endif
+      start(blockcount);
+    }
+
+    /// Writes to _dest_ using _blockcount_ blocks of _blocksize_ bytes.
+    JsonWriteBehindBuffer(std::streambuf* dest, size_t blocksize = 1024*1024, size_t blockcount = 4)
+    : dest_(dest), blocksize_(blocksize) {
+      if (dest_) start(blockcount);
+    }
+
+    JsonWriteBehindBuffer(const JsonWriteBehindBuffer&) = delete;
+    JsonWriteBehindBuffer& operator=(const JsonWriteBehindBuffer&) = delete;
+
+    ~JsonWriteBehindBuffer() {close();}
+
+    /// Returns true if the destination could be opened.
+    bool isOpen() const {return opened_;}
+
+    /// Returns true if an I/O error occurred.
+    bool hasFailed() const {return failed_;}
+
+    /** Writes the remaining data, syncs and closes the file.
+     *  Returns false if an error occurred.
+     */
+    bool close() {
+      if (!thread_.joinable()) return opened_ && !failed_;
+      sync();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cond_.notify_all();
+      thread_.join();
+#if JSONSERIAL_POSIX
+      if (fd_ >= 0) {
+        if (::fsync(fd_) != 0) failed_ = true;
+        if (::close(fd_) != 0) failed_ = true;
+        fd_ = -1;
+      }
+#endif
+      if (dest_ && dest_->pubsync() != 0) failed_ = true;
+#if !JSONSERIAL_POSIX
+      if (dest_ == &file_ && !file_.close()) failed_ = true;
+#endif
+      return !failed_;
+    }
+
+  protected:
+    int_type overflow(int_type c) override {
+      if (!thread_.joinable()) return traits_type::eof();
+      submit();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]{return !free_.empty();});
+        current_ = free_.back();
+        free_.pop_back();
+      }
+      char* data = blocks_[current_].data_.get();
+      setp(data, data + blocksize_);
+      if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+      }
+      return failed_ ? traits_type::eof() : traits_type::not_eof(c);
+    }
+
+    // waits until all data has been written.
+    int sync() override {
+      if (!thread_.joinable()) return -1;
+      submit();
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]{return full_.empty() && !busy_;});
+      return failed_ ? -1 : 0;
+    }
+
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data_;
+      size_t size_{0};
+    };
+
+    void start(size_t blockcount) {
+      blocks_.resize(blockcount < 2 ? 2 : blockcount);
+      for (size_t k = 0; k < blocks_.size(); ++k) {
+        blocks_[k].data_.reset(new char[blocksize_]);
+        free_.push_back(k);
+      }
+      opened_ = true;
+      thread_ = std::thread(&JsonWriteBehindBuffer::drain, this);
+    }
+
+    // hands the current block to the writing thread.
+    void submit() {
+      if (current_ == npos) return;
+      blocks_[current_].size_ = size_t(pptr() - pbase());
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        full_.push_back(current_);
+      }
+      cond_.notify_all();
+      current_ = npos;
+      setp(nullptr, nullptr);
+    }
+
+    // writes the full blocks (in the writing thread).
+    void drain() {
+      while (true) {
+        size_t k;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cond_.wait(lock, [this]{return stop_ || !full_.empty();});
+          if (full_.empty()) return;   // stopped
+          k = full_.front();
+          full_.pop_front();
+          busy_ = true;
+        }
+        if (!failed_) writeDest(blocks_[k].data_.get(), blocks_[k].size_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          free_.push_back(k);
+          busy_ = false;
+        }
+        cond_.notify_all();
+      }
+    }
+
+    void writeDest(const char* data, size_t size) {
+#if JSONSERIAL_POSIX
+      if (fd_ >= 0) {
+        while (size > 0) {
+          ssize_t n = ::write(fd_, data, size);
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) {failed_ = true; return;}
+          data += n;
+          size -= size_t(n);
+        }
+        return;
+      }
+#endif
+      if (dest_->sputn(data, std::streamsize(size)) != std::streamsize(size)) failed_ = true;
+    }
+
+    static constexpr size_t npos = size_t(-1);
+    std::streambuf* dest_{nullptr};
+#if JSONSERIAL_POSIX
+    int fd_{-1};
+#else
+    std::filebuf file_;
+#endif
+    size_t blocksize_, current_{npos};
+    std::vector<Block> blocks_;
+    std::vector<size_t> free_;
+    std::deque<size_t> full_;
+    bool opened_{false}, stop_{false}, busy_{false};
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;
+  };
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  /** Storage for the strings that are read as char*, const char*, std::string_view
+   *  or InternedString.
+   *  Strings are stored contiguously in large blocks instead of being allocated
+   *  one by one (by strdup()). They remain valid as long as the JsonStringBuffer exists
+   *  and must NOT be freed.
+   *
+   *  If _interning_ is true, identical strings are only stored once (and thus
+   *  char* strings must not be modified). This saves memory when the same values
+   *  are repeated many times.
+   *  @see JsonSerial::setStringBuffer().
+   */
+  class JsonStringBuffer {
+  public:
+    /// _blocksize_ is the size of the memory blocks that are allocated.
+    JsonStringBuffer(bool interning = false, size_t blocksize = 64*1024)
+    : interning_(interning), blocksize_(blocksize) {}
+
+    JsonStringBuffer(const JsonStringBuffer&) = delete;
+    JsonStringBuffer& operator=(const JsonStringBuffer&) = delete;
+
+    /// Copies a string in the buffer, returns a pointer to the (null-terminated) copy.
+    char* add(const char* s, size_t len) {
+      if (len + 1 > blocksize_ - used_) {
+        if (len + 1 > blocksize_ / 4) {  // big string: allocated separately
+          blocks_.emplace_front(new char[len + 1]);
+          return copy(blocks_.front().get(), s, len);
+        }
+        blocks_.emplace_back(new char[blocksize_]);
+        used_ = 0;
+      }
+      char* p = copy(blocks_.back().get() + used_, s, len);
+      used_ += len + 1;
+      return p;
+    }
+
+    char* add(const std::string& s) {return add(s.data(), s.size());}
+
+    /// Returns the stored copy of this string, stores it if not already stored.
+    char* intern(const std::string& s) {
+      auto it = interned_.find(s.c_str());
+      if (it != interned_.end()) return const_cast<char*>(*it);
+      char* p = add(s);
+      interned_.insert(p);
+      return p;
+    }
+
+    /// Copies a string in the buffer, or interns it if interning is on.
+    char* store(const std::string& s) {return interning_ ? intern(s) : add(s);}
+
+    /// Returns true if identical strings are stored once.
+    bool isInterning() const {return interning_;}
+
+    /// Returns the number of allocated blocks.
+    size_t blockCount() const {return blocks_.size();}
+
+    /// Returns the number of interned strings.
+    size_t internedCount() const {return interned_.size();}
+
+  private:
+    static char* copy(char* p, const char* s, size_t len) {
+      ::memcpy(p, s, len);
+      p[len] = 0;
+      return p;
+    }
+
+    struct Hash {    // FNV-1a
+      size_t operator()(const char* s) const {
+        size_t h = 2166136261u;
+        for (; *s; ++s) h = (h ^ (unsigned char)*s) * 16777619u;
+        return h;
+      }
+    };
+
+    struct Equal {
+      bool operator()(const char* s1, const char* s2) const {return ::strcmp(s1, s2) == 0;}
+    };
+
+    bool interning_;
+    size_t blocksize_, used_{blocksize_};
+    std::list<std::unique_ptr<char[]>> blocks_;
+    std::unordered_set<const char*, Hash, Equal> interned_;
+  };
+
+}
+
+#endif
@@ -29,6 +29,12 @@ namespace jsonserial {
   class JsonClasses;
   
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  
+  // FNV-1a hash of a string (including the final 0), used by JsonClasses::fingerprint().
+  inline uint64_t hashString(const std::string& s, uint64_t h = 14695981039346656037ULL) {
+    for (size_t k = 0; k <= s.size(); ++k) {h ^= (unsigned char)s.c_str()[k]; h *= 1099511628211ULL;}
+    return h;
+  }
 
   /// Generic Metaclass.
   class MetaClass {
@@ -41,8 +47,21 @@ namespace jsonserial {
     virtual ~MetaClass() {}
     virtual const std::string& classname() const = 0;
     virtual void* create() const = 0;
+    virtual void* create(JsonArena&) const = 0;
+    virtual std::shared_ptr<void> createShared(JsonArena*) const = 0;
+    virtual void adopt(JsonArena&, void* obj) const = 0;
     virtual bool readMember(JsonSerial&, void* obj, const std::string& name,
                             const std::string& value) const = 0;
+    // same as readMember(), _next_ is the index of the member that is expected to follow.
+    virtual bool readNextMember(JsonSerial& js, void* obj, const std::string& name,
+                                const std::string& value, size_t& /*next*/) const {
+      return readMember(js, obj, name, value);
+    }
+    virtual uint64_t fingerprint() const {return hashString(classname());}
+    virtual void clearUnknowns(void* /*obj*/) const {}
+    virtual bool validateMember(JsonSerial&, const std::string& name,
+                                const std::string& value) const = 0;
+    virtual bool hasCreator() const = 0;
     virtual void writeMembers(JsonSerial&, const void* obj) const = 0;
     virtual void doPostRead(void* obj) const = 0;
     virtual void doPostWrite(const void* obj) const = 0;
@@ -52,6 +71,7 @@ namespace jsonserial {
   
   struct JsonArray {
     virtual ~JsonArray() {}
+    virtual void begin(JsonSerial&) {}
     virtual void add(JsonSerial&, MetaClass::Creator*, const std::string& s) = 0;
     virtual void end(JsonSerial&) {}
   };
@@ -60,6 +80,48 @@ namespace jsonserial {
   
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   
+  /** Stores the members of an object that are not declared in its class.
+   *  The names and the (raw JSON) values of these members are kept in a single
+   *  buffer, so that they can be written back when the object is written.
+   *  @see ObjectClass::unknowns().
+   */
+  class JsonUnknowns {
+  public:
+    /// Returns true if there are no unknown members.
+    bool empty() const {return data_.empty();}
+    
+    /// Removes all unknown members.
+    void clear() {data_.clear();}
+    
+    /// Adds a member, _value_ must be valid JSON.
+    void add(const std::string& name, const std::string& value) {
+      data_.append(name).push_back('\0');
+      data_.append(value).push_back('\0');
+    }
+    
+    /// Returns the JSON text of this member, an empty string if there is no such member.
+    std::string get(const std::string& name) const {
+      std::string value;
+      forEach([&](const char* n, const char* v) {if (name == n) value = v;});
+      return value;
+    }
+    
+    /// Calls _fun_(name, value) for each member.
+    template <class Fun> void forEach(Fun fun) const {
+      for (size_t k = 0; k < data_.size(); ) {
+        const char* n = data_.c_str() + k;
+        const char* v = n + ::strlen(n) + 1;
+        fun(n, v);
+        k = (v - data_.c_str()) + ::strlen(v) + 1;
+      }
+    }
+    
+  private:
+    std::string data_;
+  };
+  
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  
   /** Serves to declare the (serialized) members of a C++ class.
    *  @see jsonserial.hpp (explanations and example).
    *  @see the member() methods of this class.
@@ -214,7 +276,7 @@ namespace jsonserial {
      *   then point to the object).
      */
     ObjectClass& postread(std::function<void(C&)> fun)
-    {postread_ = fun; return *this;}
+    {if (!frozen("postread()")) postread_ = fun; return *this;}
     
     /** Calls a function once all members have been written.
      * Argument:
@@ -228,18 +290,35 @@ namespace jsonserial {
      *   then point to the object).
      */
     ObjectClass& postwrite(std::function<void(const C&)> fun)
-    {postwrite_ = fun; return *this;}
+    {if (!frozen("postwrite()")) postwrite_ = fun; return *this;}
+    
+    /** Keeps the members that are not declared in this class.
+     * Argument:
+     * - _var_: an instance variable of type JsonUnknowns
+     *
+     * The members found in the JSON file that are not declared in this class
+     * (and its superclasses) are stored in _var_ instead of producing an error,
+     * and they are written back after the other members when the object is written.
+     * This allows reading and writing files produced by a newer version of
+     * a program without losing data.
+     */
+    ObjectClass& unknowns(JsonUnknowns C::* var)
+    {if (!frozen("unknowns()")) unknowns_ = var; return *this;}
     
     class Member {
     public:
-      Member(const std::string& name) : name_(name) {}
+      Member(const std::string& name, const std::type_info& type = typeid(void))
+      : name_(name), type_(&type) {}
       virtual ~Member() {}
       const std::string& name() const {return name_;}
+      const char* typeName() const {return type_->name();}  // implementation-specific
       virtual bool isCustom() const {return false;}
       virtual void read(JsonSerial&, C& object, const std::string& value) = 0;
       virtual void write(JsonSerial&, const C& object) = 0;
+      virtual void validate(JsonSerial&, const std::string& value);
     protected:
       const std::string name_;
+      const std::type_info* type_;
     };
     
   protected:
@@ -250,13 +329,35 @@ namespace jsonserial {
     virtual ~ObjectClass() {for (auto& it : members_) delete it;}
     
     void* create() const override {return creator_ ? (creator_)() : nullptr;}
+    void* create(JsonArena& a) const override {
+      if (arena_creator_) return (arena_creator_)(a);
+      void* obj = create(); adopt(a, obj); return obj;
+    }
+    void adopt(JsonArena& a, void* obj) const override {adoptObject<C>(a, obj);}
+    std::shared_ptr<void> createShared(JsonArena* a) const override
+    {return shared_creator_ ? (shared_creator_)(a) : nullptr;}
+    bool hasCreator() const override {return bool(creator_);}
     void addMember(const std::string& varname, Member*);
+    bool frozen(const char* where) const;
     Member* getMember(const std::string& varname) const;
     bool readMember(JsonSerial&, void* obj, const std::string& name, const std::string& val) const override;
+    bool readNextMember(JsonSerial&, void* obj, const std::string& name, const std::string& val,
+                        size_t& next) const override;
+    uint64_t fingerprint() const override;
+    void clearUnknowns(void* obj) const override;
+    bool validateMember(JsonSerial&, const std::string& name, const std::string& val) const override;
     void writeMembers(JsonSerial&, const void* obj) const override;
     void doPostRead(void* obj) const override;
     void doPostWrite(const void* obj) const override;
     
+    // objects can't be deleted through an abstract class without a virtual destructor.
+    template <class T> static typename std::enable_if<!std::is_abstract<T>::value
+    || std::has_virtual_destructor<T>::value>::type adoptObject(JsonArena& a, void* obj)
+    {a.adopt(static_cast<T*>(obj));}
+    
+    template <class T> static typename std::enable_if<std::is_abstract<T>::value
+    && !std::has_virtual_destructor<T>::value>::type adoptObject(JsonArena&, void*) {}
+    
     struct Superclass {
       const MetaClass* super_;
       std::function<void*(void*)> upcast_;
@@ -271,22 +372,38 @@ namespace jsonserial {
     const std::string classname_;
     Superclasses superclasses_;
     std::function<C*()> creator_{nullptr};
-    std::list<Member*> members_;
+    std::function<C*(JsonArena&)> arena_creator_{nullptr};
+    std::function<std::shared_ptr<C>(JsonArena*)> shared_creator_{nullptr};
+    std::vector<Member*> members_;   // in declaration order (= the order they are written)
     std::unordered_map<std::string, Member*> membermap_;
     std::function<void(C&)> postread_{nullptr};
     std::function<void(const C&)> postwrite_{nullptr};
+    JsonUnknowns C::* unknowns_{nullptr};
   };
   
   
   /// @internal Metaclass for maps.
   template <class C> class MapClass : public MetaClass {
   public:
+    /** if _reuse_ is true, existing values are overwritten and missing keys are removed.
+     *  if _merge_ is true, existing values are overwritten and other keys are kept.
+     */
+    MapClass(bool reuse = false, bool merge = false) : reuse_(reuse), merge_(merge) {}
     const std::string& classname() const override {static std::string s("std::map"); return s;}
     void* create() const override {return new C();}
+    void* create(JsonArena& a) const override {return a.create<C>();}
+    void adopt(JsonArena& a, void* obj) const override {a.adopt(static_cast<C*>(obj));}
+    std::shared_ptr<void> createShared(JsonArena* a) const override
+    {return a ? std::allocate_shared<C>(JsonArenaAllocator<C>(a)) : std::make_shared<C>();}
+    bool hasCreator() const override {return true;}
     bool readMember(JsonSerial&, void* obj, const std::string& name, const std::string& value) const override;
+    bool validateMember(JsonSerial&, const std::string& name, const std::string& value) const override;
     void writeMembers(JsonSerial&, const void* obj) const override;
-    void doPostRead(void*) const override {}
+    void doPostRead(void* obj) const override;
     void doPostWrite(const void*) const override {}
+  private:
+    bool reuse_, merge_;
+    mutable std::vector<const void*> seen_;  // values that were read (reuse mode)
   };
   
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -294,6 +411,10 @@ namespace jsonserial {
   /** @brief Serves to declare the C++ classes that are serialized.
    * @see jsonserial.hpp for explanations and an example.
    * @see defclass() methods for declaring classes.
+   *
+   * Once all classes have been declared, freeze() makes the JsonClasses immutable.
+   * A frozen JsonClasses can then be shared by any number of JsonSerials running
+   * concurrently in different threads (each thread must use its own JsonSerial).
    */
   class JsonClasses {
   public:
@@ -307,6 +428,7 @@ namespace jsonserial {
     
     ~JsonClasses() {
       for (auto& it : classnames_) delete it.second;
+      for (auto& it : rejected_) delete it;
       delete jsonerror_;
     }
     
@@ -320,8 +442,17 @@ namespace jsonserial {
      */
     template <class Class>
     ObjectClass<Class>& defclass(const std::string& classname) {
-      struct Helper {static Class* create() {return new Class();} ;};
-      return defclass<Class>(classname, Helper::create);
+      struct Helper {
+        static Class* create() {return new Class();}
+        static Class* createIn(JsonArena& a) {return a.create<Class>();}
+        static std::shared_ptr<Class> createShared(JsonArena* a) {
+          return a ? std::allocate_shared<Class>(JsonArenaAllocator<Class>(a)) : std::make_shared<Class>();
+        }
+      };
+      ObjectClass<Class>& cl = defclass<Class>(classname, Helper::create);
+      cl.arena_creator_ = Helper::createIn;
+      cl.shared_creator_ = Helper::createShared;
+      return cl;
     }
     
     /** Declares a C++ class WITHOUT a public no-argument constructor (or an ABSTRACT class).
@@ -341,6 +472,32 @@ namespace jsonserial {
     template <class Class>
     ObjectClass<Class>& defclass(const std::string& classname, std::function<Class*()> creator);
     
+    /** Makes these classes immutable.
+     * Classes can no longer be declared or modified: defclass() and the methods
+     * of ObjectClass that declare members then produce a FrozenClasses error
+     * and have no effect. These classes can then be used concurrently by
+     * JsonSerials running in different threads without locks.
+     * This method should be called before starting these threads.
+     */
+    void freeze() {fingerprint(); frozen_ = true;}
+    
+    /** Returns a fingerprint of these classes.
+     * The fingerprint depends on the names of the classes, of their superclasses and
+     * of their members (in the order they were declared) and on the types of the
+     * members, but not on the order the classes were declared. As type names are
+     * implementation-specific, programs compiled with different compilers may get
+     * different fingerprints. It is computed once, and again only if the classes
+     * have been modified since.
+     * @see JsonSerial::setFingerprint().
+     */
+    uint64_t fingerprint() const {
+      if (!fingerprinted_) {fingerprint_ = computeFingerprint(); fingerprinted_ = true;}
+      return fingerprint_;
+    }
+    
+    /// Returns true if freeze() was called.
+    bool isFrozen() const {return frozen_;}
+    
     /// Produces an error.
     void error(JsonError::Type type, const std::string& arg, const std::string& where) {
       if (!jsonerror_) jsonerror_ = new JsonError();
@@ -363,8 +520,23 @@ namespace jsonserial {
     }
     
   private:
+    template <class C> friend class ObjectClass;
+    
+    // called when the classes are modified.
+    void modified() {fingerprinted_ = false;}
+    
+    uint64_t computeFingerprint() const {
+      uint64_t h{0};
+      for (auto& it : classnames_) h += it.second->fingerprint();
+      return h;
+    }
+    
     JsonError::Handler errhandler_{nullptr};
     JsonError* jsonerror_{nullptr};
+    bool frozen_{false};
+    mutable bool fingerprinted_{false};
+    mutable uint64_t fingerprint_{0};
+    std::vector<MetaClass*> rejected_;  // classes declared after freeze()
     std::unordered_map<std::type_index, MetaClass*> classindexes_;
     std::unordered_map<std::string, MetaClass*> classnames_;
   };
@@ -24,6 +24,8 @@
 
 namespace jsonserial {
 
+  class MetaClass;
+
   /// is this objet a C++ array (not to be confused with C-style bracketed arrays)?.
   template <class T> struct is_std_array : std::false_type {};
   
@@ -54,6 +56,12 @@ namespace jsonserial {
   template <class T> struct is_smart_ptr<std::unique_ptr<T>> : std::true_type {};
   template <class T> struct is_smart_ptr<std::weak_ptr<T>> : std::true_type {};
   
+  /* has this object its own JSON format?.
+   * such objects (e.g. Lazy) are read and written by their readJson(), writeJson()
+   * and validateJson() methods.
+   */
+  template <class T> struct has_custom_format : std::false_type {};
+  
   /* is this object a "defobject"?.
    * a defobject is a C++ object that must be defined using JsonClasses::defclass()
    * if it is serialized (runtime error otherwise)
@@ -61,7 +69,11 @@ namespace jsonserial {
   template <class T> struct is_defobject {
     static constexpr bool value = std::is_class<T>::value
     && !std::is_base_of<std::string, T>::value
-    && !is_smart_ptr<T>::value && !has_array_format<T>::value && !is_std_map<T>::value;
+#if __cplusplus >= 201703L
+    && !std::is_same<std::string_view, T>::value
+#endif
+    && !is_smart_ptr<T>::value && !has_array_format<T>::value && !is_std_map<T>::value
+    && !has_custom_format<T>::value;
   };
  
   /// Obtains the pointer type corresponding to T,
@@ -86,7 +98,15 @@ namespace jsonserial {
     typedef typename make_pointer<typename X::value_type>::type type;
   };
  
-  struct ObjectPtr {void *raw_{nullptr}, *shared_{nullptr}; bool init_{false};};
+  /* an object that has an @id.
+   * shared_ owns the object if it is pointed by shared_ptrs.
+   * class_ is the class of the object (only used by JsonDelta, not valid for maps).
+   */
+  struct ObjectPtr {
+    void *raw_{nullptr};
+    std::weak_ptr<void> shared_;
+    const MetaClass* class_{nullptr};
+  };
 
 }
 #endif
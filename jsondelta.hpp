@@ -0,0 +1,299 @@
+//
+//  jsondelta.hpp: must be included for writing and reading incremental checkpoints
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_jsondelta_hpp
+#define jsonserial_jsondelta_hpp
+
+namespace jsonserial {
+
+  /** Incremental checkpoints of a graph of objects.
+   * writeSnapshot() writes the whole graph and keeps a fingerprint of each member
+   * of each object. writeDelta() then only writes the members that have changed since
+   * the previous checkpoint: its output is proportional to the amount of change,
+   * not to the size of the graph.
+   * On the other side, readSnapshot() reads a snapshot and readDelta() applies
+   * the deltas to the objects that were read.
+   *
+   * A delta is a JSON array of objects, each of them containing the "@id" of an
+   * object and the members of this object that have changed. The objects that were
+   * added to the graph are declared first, by their "@id" and "@class", then
+   * written as the other objects. The pointees of raw and smart pointers are written
+   * as "@id" references. A snapshot is a delta that contains all objects.
+   *
+   * The root must be an object or a pointer to an object. Objects are identified by
+   * their address (and their class). The same JsonDelta must be used for all the
+   * checkpoints of a graph, and different JsonDeltas must be used for writing and
+   * for reading. If writeDelta() fails, a new snapshot must be written.
+   *
+   * Example:
+   * @code
+   *   JsonDelta delta;
+   *   delta.writeSnapshot(js, contacts, out);
+   *   ...   // contacts are modified
+   *   delta.writeDelta(js, contacts, out2);
+   *
+   *   JsonDelta delta2;
+   *   delta2.readSnapshot(js2, contacts2, in);
+   *   delta2.readDelta(js2, in2);
+   * @endcode
+   */
+  class JsonDelta : public JsonSerial::IdTracker {
+  public:
+    JsonDelta() = default;
+    JsonDelta(const JsonDelta&) = delete;
+    JsonDelta& operator=(const JsonDelta&) = delete;
+
+    /** Writes the whole graph of objects and starts tracking changes.
+     *  Arguments: see JsonSerial::write(const T&, std::ostream&, const std::string&, size_t).
+     */
+    template <class T>
+    bool writeSnapshot(JsonSerial& js, const T& root, std::ostream& out, const std::string& name = "") {
+      clear();
+      return writeDelta(js, root, out, name);
+    }
+
+    /** Writes the members that have changed since the previous checkpoint.
+     *  Arguments: see writeSnapshot().
+     */
+    template <class T>
+    bool writeDelta(JsonSerial& js, const T& root, std::ostream& out, const std::string& name = "") {
+      std::string delta;
+      if (!diff(js, root, delta, name)) return false;
+      out << "[" << (delta.empty() ? delta : delta.substr(1)) << "\n]\n" << std::flush;
+      return true;
+    }
+
+    /** Reads a snapshot written by writeSnapshot().
+     *  Arguments: see JsonSerial::read(T&, std::istream&, const std::string&, size_t).
+     */
+    template <class T>
+    bool readSnapshot(JsonSerial& js, T& root, std::istream& in,
+                      const std::string& name = "", size_t line = 1) {
+      clear();
+      if (!bindRoot(js, root)) return false;
+      if (!readDelta(js, in, name, line)) return false;
+      js.id_to_object_.swap(ids_);
+      JSONSERIAL_TRY {readRoot(js, root);}
+      JSONSERIAL_CATCH(JsonError*) {}
+      js.id_to_object_.swap(ids_);
+      return !js.jsonerror_;
+    }
+
+    /** Applies a delta written by writeDelta() to the objects that were read.
+     *  Arguments: see readSnapshot().
+     */
+    bool readDelta(JsonSerial& js, std::istream& in, const std::string& name = "", size_t line = 1) {
+      bool ok = true;
+      js.reset(name, line, &in, nullptr);
+      js.id_to_object_.swap(ids_);
+      JSONSERIAL_TRY {
+        std::string tok, dump;
+        bool found1, found2;
+        JsonSerial::TokenScope scope{js};   // see tokenType()
+        js.readLine(tok, dump, found1, found2, false);
+        if (!found1) js.error(JsonError::NoData);
+        else if (tok != "[") js.error(JsonError::ExpectingBracket);
+        while (!js.failed()) {
+          js.readLine(tok, dump, found1, found2, false);
+          if (js.failed()) break;
+          else if (!found1) js.error(JsonError::ExpectingValueOrBracket);
+          else if (tok == "]") break;
+          else if (tok != "{") js.error(JsonError::ExpectingBrace);
+          else readEntry(js);
+        }
+      }
+      JSONSERIAL_CATCH(JsonError*) {ok = false;}
+      js.id_to_object_.swap(ids_);
+      return ok && !js.jsonerror_;
+    }
+
+    /// Forgets all objects: a new snapshot must be written or read.
+    void clear() {
+      objects_.clear();
+      ids_.clear();
+      stubs_.clear();
+      entries_.clear();
+      last_id_ = 0;
+    }
+
+  private:
+    struct Key {
+      const void* obj_;
+      const MetaClass* class_;
+      bool operator==(const Key& k) const {return obj_ == k.obj_ && class_ == k.class_;}
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& k) const {
+        return std::hash<const void*>()(k.obj_) ^ std::hash<const void*>()(k.class_);
+      }
+    };
+
+    struct Object {
+      unsigned long id_{0}, pass_{0};
+      std::vector<size_t> hashes_;   // fingerprints of the members
+      bool new_{false};
+    };
+
+    // writes the members of all objects in _buf_ and sets _delta_ to their changes.
+    template <class T>
+    bool diff(JsonSerial& js, const T& root, std::string& delta, const std::string& name) {
+      std::ostringstream buf;
+      std::vector<std::streamoff> marks;
+      bool ok = true;
+      js.reset(name, 0, nullptr, &buf);
+      js.delta_ = this;
+      ++pass_;
+      queue_.clear();
+      delta.clear();
+      JSONSERIAL_TRY {
+        writeRoot(js, root);
+        js.marks_ = &marks;
+        for (size_t k = 0; k < queue_.size() && !js.failed(); ++k) {  // queue_ grows while writing
+          Key key = queue_[k];
+          Object& o = objects_[key];
+          buf.str("");
+          marks.clear();
+          js.level_ = 1;
+          js.needcomma_ = false;
+          key.class_->writeMembers(js, key.obj_);
+          key.class_->doPostWrite(key.obj_);
+          marks.push_back(buf.tellp());
+          addChanges(o, buf.str(), marks);
+        }
+      }
+      JSONSERIAL_CATCH(JsonError*) {ok = false;}
+      js.delta_ = nullptr;
+      js.marks_ = nullptr;
+      js.out_ = nullptr;
+      if (!ok || js.failed()) {clear(); return false;}
+      for (auto it = objects_.begin(); it != objects_.end(); ) {  // objects no longer in the graph
+        if (it->second.pass_ != pass_) it = objects_.erase(it); else ++it;
+      }
+      delta = stubs_ + entries_;
+      stubs_.clear();
+      entries_.clear();
+      return !js.jsonerror_;
+    }
+
+    template <class T>
+    typename std::enable_if<is_defobject<T>::value>::type
+    writeRoot(JsonSerial& js, const T& root) {js.writePointee(root);}
+
+    template <class T>
+    typename std::enable_if<!is_defobject<T>::value>::type
+    writeRoot(JsonSerial& js, const T& root) {js.writeValue(root);}
+
+    // the root object has ID 1.
+    template <class T>
+    typename std::enable_if<is_defobject<T>::value,bool>::type
+    bindRoot(JsonSerial& js, T& root) {
+      ObjectPtr& p = ids_[1];
+      p.raw_ = &root;
+      p.class_ = js.getClasses().getClass(typeid(root));
+      return p.class_ != nullptr;
+    }
+
+    template <class T>
+    typename std::enable_if<!is_defobject<T>::value,bool>::type
+    bindRoot(JsonSerial&, T&) {return true;}
+
+    template <class T>
+    typename std::enable_if<is_defobject<T>::value>::type
+    readRoot(JsonSerial&, T&) {}
+
+    template <class T>
+    typename std::enable_if<!is_defobject<T>::value>::type
+    readRoot(JsonSerial& js, T& root) {
+      if (js.id_to_object_.count(1)) readValue(js, root, "@1");
+    }
+
+    // compares the members (delimited by _marks_) with their fingerprints.
+    void addChanges(Object& o, const std::string& text, const std::vector<std::streamoff>& marks) {
+      size_t count = marks.size() - 1;
+      bool all = o.new_ || o.hashes_.size() != count;
+      o.new_ = false;
+      o.hashes_.resize(count);
+      std::string changes;
+      for (size_t k = 0; k < count; ++k) {
+        size_t begin = size_t(marks[k]), end = size_t(marks[k+1]);
+        if (text.compare(begin, 2, ",\n") == 0) begin += 2;
+        std::string member = text.substr(begin, end - begin);
+        size_t hash = std::hash<std::string>()(member);
+        if (all || hash != o.hashes_[k]) {
+          o.hashes_[k] = hash;
+          if (!member.empty()) {changes += ",\n"; changes += member;}
+        }
+      }
+      if (all || !changes.empty())
+        entries_ += ",\n{\n  \"@id\": \"" + std::to_string(o.id_) + "\"" + changes + "\n}";
+    }
+
+    unsigned long objectID(const void* obj, const MetaClass& cl, bool pointee) override {
+      Key key{obj, &cl};
+      Object& o = objects_[key];
+      if (!o.id_) {   // new object
+        o.id_ = ++last_id_;
+        o.new_ = true;
+        if (pointee) stubs_ += ",\n{\"@id\": \"" + std::to_string(o.id_)
+          + "\", \"@class\": \"" + cl.classname() + "\"}";
+      }
+      if (o.pass_ != pass_) {
+        o.pass_ = pass_;
+        if (pointee) queue_.push_back(key);
+      }
+      return o.id_;
+    }
+
+    // reads an element of a delta, the object is created if it is new.
+    void readEntry(JsonSerial& js) {
+      std::string name, value;
+      bool found1, found2;
+      JsonSerial::TokenScope scope{js};   // see tokenType()
+      js.readLine(name, value, found1, found2, true);
+      if (js.failed()) return;
+      if (name != "@id") {js.error(JsonError::WrongKeyword, name); return;}
+      ObjectPtr* jsp = &js.id_to_object_[std::strtoul(value.c_str(), nullptr, 0)];
+      if (!jsp->raw_) {
+        js.readLine(name, value, found1, found2, true);
+        if (js.failed()) return;
+        if (name != "@class") {js.error(JsonError::WrongKeyword, name); return;}
+        const MetaClass* cl = js.classes_.getClass(value);
+        if (!cl) {js.error(JsonError::UnknownClass, value); return;}
+        jsp->raw_ = js.arena_ ? cl->create(*js.arena_) : cl->create();
+        if (!jsp->raw_) {js.error(JsonError::AbstractClass, value); return;}
+        jsp->class_ = cl;
+      }
+      else if (!jsp->class_) {js.error(JsonError::InvalidID, value); return;}
+      const MetaClass* cl = jsp->class_;
+      readObject(js, cl, cl, jsp, nullptr, jsp->raw_, "{");
+    }
+
+    std::unordered_map<Key, Object, KeyHash> objects_;  // written objects
+    std::unordered_map<unsigned long, ObjectPtr> ids_;  // read objects
+    std::vector<Key> queue_;   // objects to write
+    std::string stubs_, entries_;   // declarations of new objects, changes
+    unsigned long last_id_{0}, pass_{0};
+  };
+
+}
+
+#endif
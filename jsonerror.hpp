@@ -25,6 +25,22 @@
 
 #include <stdexcept>
 
+/* If JSONSERIAL_NO_EXCEPTIONS is defined (it is by default if exceptions are disabled),
+ * JsonSerial does not throw exceptions internally: errors are propagated by returning
+ * from the reading and writing functions (see JsonSerial::error()).
+ */
+#if !defined(JSONSERIAL_NO_EXCEPTIONS) && defined(__GNUC__) && !defined(__cpp_exceptions)
+#define JSONSERIAL_NO_EXCEPTIONS 1
+#endif
+
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+#define JSONSERIAL_TRY if (true)
+#define JSONSERIAL_CATCH(decl) else
+#else
+#define JSONSERIAL_TRY try
+#define JSONSERIAL_CATCH(decl) catch (decl)
+#endif
+
 namespace jsonserial {
   
   /** @brief JsonSerial error.
@@ -38,7 +54,7 @@ namespace jsonserial {
       ExpectingPairOrBrace, ExpectingValueOrBracket, ExpectingString,
       UnknownClass, UnknownSuperclass, RedefinedClass, RedefinedSuperclass,
       UnknownMember, RedefinedMember, AbstractClass, CantCreateObject, CantAddToArray,
-      InvalidValue, InvalidID, WrongKeyword, ErrorCount
+      InvalidValue, InvalidID, DuplicateID, WrongKeyword, NoStringBuffer, FrozenClasses, ErrorCount
     };
     
     /// Returns the corresponding error message.
@@ -68,16 +84,21 @@ namespace jsonserial {
         "C-style array is too small to add value",
         "invalid value:",
         "ID number expected after @",
+        "object ID is already defined:",
         "expecting @id or @class before",
+        "a string buffer is required for reading std::string_view or InternedString (see setStringBuffer())",
+        "classes are frozen (see JsonClasses::freeze())",
       };
       if (type >= ErrorCount) return "Unknown error";
       else return _errors[type];
     }
     
-    Type type;
-    bool fatal;
+    Type type{OK};
+    bool fatal{false};
     std::string where, arg, streamname;
-    size_t line;
+    std::string classname, member;   // class and member concerned by the error (if any)
+    size_t line{0}, column{0};  // 0 if unknown
+    size_t offset{0};  // position of the error in bytes (from the beginning of the read when reading)
 
     /// JsonError Error handler.
     using Handler = std::function<void(const JsonError&)>;
@@ -92,6 +113,7 @@ namespace jsonserial {
       arg = arg_;
       streamname = streamname_;
       line = line_;
+      column = offset = 0;
       if (errhandler_) (errhandler_)(*this); else print(std::cerr);
     }
     
@@ -102,12 +124,74 @@ namespace jsonserial {
       else if (where=="write") out << "while writing file ";
       else out << "in " << where;
       if (line > 0) out << "at or before line " << line;
+      if (column > 0) out << ", column " << column;
+      if (offset > 0) out << (line > 0 ? " " : "") << "(offset " << offset << ")";
       if (!streamname.empty()) out << " in '" << streamname << "'";
-      out << ":\n- "<< error(type); if (!arg.empty()) out << " " << arg;
+      out << ":\n- "<< error(type);
+      if (!arg.empty()) out << " " << arg;
+      else if (!member.empty()) out << " '" << member << "' in class '" << classname << "'";
       out << std::endl;
     }
   };
   
+  /** @brief Collects errors instead of reporting them one by one.
+   * Errors are stored in the order they first occurred and are only formatted when
+   * print() is called. Errors of the same type for the same class and member
+   * are stored once (with the argument of the first one) and counted. At most _capacity_ distinct errors are stored,
+   * the other ones are only counted (see dropped()).
+   * @see JsonSerial::setErrorLog().
+   */
+  class JsonErrorLog {
+  public:
+    JsonErrorLog(size_t capacity = 100) : capacity_(capacity) {}
+    
+    /// Returns the number of distinct errors.
+    size_t size() const {return errors_.size();}
+    
+    /// Returns the kth distinct error.
+    const JsonError& error(size_t k) const {return errors_[k];}
+    
+    /// Returns how many times the kth error occurred.
+    size_t count(size_t k) const {return counts_[k];}
+    
+    /// Returns the number of errors that were not stored because the log was full.
+    size_t dropped() const {return dropped_;}
+    
+    /// Removes all errors.
+    void clear() {errors_.clear(); counts_.clear(); indexes_.clear(); dropped_ = 0;}
+    
+    /// Prints all errors on _out_.
+    void print(std::ostream& out) const {
+      for (size_t k = 0; k < errors_.size(); ++k) {
+        errors_[k].print(out);
+        if (counts_[k] > 1) out << "  (" << counts_[k] << " times)" << std::endl;
+      }
+      if (dropped_ > 0) out << "... and " << dropped_ << " other errors" << std::endl;
+    }
+    
+    /// Adds an error (called by JsonSerial).
+    void add(const JsonError& e) {
+      key_.assign(1, char('A' + e.type));
+      key_ += e.classname; key_ += '\0';
+      key_ += e.member;
+      auto it = indexes_.find(key_);
+      if (it != indexes_.end()) ++counts_[it->second];
+      else if (errors_.size() >= capacity_) ++dropped_;
+      else {
+        indexes_[key_] = errors_.size();
+        errors_.push_back(e);
+        counts_.push_back(1);
+      }
+    }
+    
+  private:
+    size_t capacity_, dropped_{0};
+    std::vector<JsonError> errors_;
+    std::vector<size_t> counts_;
+    std::unordered_map<std::string, size_t> indexes_;
+    std::string key_;
+  };
+  
 }
 
 #endif
@@ -29,7 +29,8 @@ namespace jsonserial {
   inline void* readObject(JsonSerial& js,
                           const MetaClass* objclass, const MetaClass* pointerclass,
                           ObjectPtr*& jsp, MetaClass::Creator* cr, void* obj,
-                          const std::string& s);
+                          const std::string& s, std::shared_ptr<void>* shared = nullptr,
+                          bool reusing = false);
   
   // reads a non-object pointee pointed by a unique_ptr
   template <class E>
@@ -49,6 +50,7 @@ namespace jsonserial {
                            ObjectPtr *& objptr,
                            MetaClass::Creator* cr,
                            const std::string& s) {
+    js.heap_next_ = true;   // will be deleted by ptr
     ptr.reset(static_cast<E*>(readObject(js, nullptr, js.getCheckedClass(typeid(E)),
                                          objptr, cr, nullptr, s)));
   }
@@ -60,10 +62,23 @@ namespace jsonserial {
                            ObjectPtr *&,
                            MetaClass::Creator*,
                            const std::string& s) {
-    ptr.reset(new E{});
+    if (js.arena_) ptr = std::allocate_shared<E>(JsonArenaAllocator<E>(js.arena_.get()));
+    else ptr = std::make_shared<E>();
     readValue(js,*ptr, s);
   }
   
+  // makes a shared_ptr point to an object that was read by readObject().
+  template <class E>
+  inline void setShared(JsonSerial& js, std::shared_ptr<E>& ptr, E* p,
+                        std::shared_ptr<void>& owner, ObjectPtr* objptr) {
+    if (!owner && objptr) owner = objptr->shared_.lock();  // already pointed by a shared_ptr
+    if (owner) ptr = std::shared_ptr<E>(owner, p);
+    else {
+      js.resetShared(ptr, p);  // created by a creator function
+      if (objptr) objptr->shared_ = ptr;
+    }
+  }
+  
   // read object pointee pointed by shared_ptr
   template <class E>
   inline void readPointee2(JsonSerial& js,
@@ -71,18 +86,10 @@ namespace jsonserial {
                            ObjectPtr *& objptr,
                            MetaClass::Creator* cr,
                            const std::string& s) {
+    std::shared_ptr<void> owner;
     E* p = static_cast<E*>(readObject(js, nullptr, js.getCheckedClass(typeid(E)),
-                                      objptr, cr, nullptr, s));
-    if (!objptr) ptr.reset(p);
-    else if (objptr->shared_) { // smart_ptr already init
-      objptr->init_ = false;
-      ptr = *static_cast<std::shared_ptr<E>*>(objptr->shared_);
-    }
-    else {
-      ptr.reset(p);
-      objptr->shared_ = &ptr;  // init smart_ptr
-      objptr->init_ = true;
-    }
+                                      objptr, cr, nullptr, s, &owner));
+    setShared(js, ptr, p, owner, objptr);
   }
   // - - -
   
@@ -93,7 +100,7 @@ namespace jsonserial {
                           ObjectPtr *&,
                           MetaClass::Creator*,
                           const std::string& s) {
-    ptr = new T{};
+    ptr = js.template createValue<T>();
     readValue(js, *ptr, s);
   }
   
@@ -119,6 +126,100 @@ namespace jsonserial {
     readPointee2<typename T::element_type>(js, ptr, objptr, cr, s);
   }
 
+  // returns the address of the complete object (objects are read through such addresses).
+  template <class E>
+  inline typename std::enable_if<std::is_polymorphic<E>::value,void*>::type
+  objectAddress(E* obj) {return dynamic_cast<void*>(obj);}
+  
+  template <class E>
+  inline typename std::enable_if<!std::is_polymorphic<E>::value,void*>::type
+  objectAddress(E* obj) {return obj;}
+  
+  // patches an existing object pointee.
+  template <class E>
+  inline void patchPointee(JsonSerial& js,
+                           typename std::enable_if<is_defobject<E>::value,E>::type & obj,
+                           const std::string& s) {
+    const MetaClass* cl = js.getCheckedClass(typeid(obj));
+    ObjectPtr* objptr{nullptr};
+    readObject(js, cl, cl, objptr, nullptr, objectAddress(&obj), s);
+  }
+  
+  // patches an existing non-object pointee.
+  template <class E>
+  inline void patchPointee(JsonSerial& js,
+                           typename std::enable_if<!is_defobject<E>::value,E>::type & obj,
+                           const std::string& s) {
+    readValue(js, obj, s);
+  }
+  
+  /* in reuse mode, reads an object pointee into the existing object if the JSON data
+   * has the same class (given by @class or by the type of the pointer). Otherwise,
+   * or if the existing object was already reused, another object is created as usual.
+   * Returns the object that was read.
+   */
+  template <class E>
+  inline void* reuseObject(JsonSerial& js, E* old, ObjectPtr*& objptr, MetaClass::Creator* cr,
+                           const std::string& s, std::shared_ptr<void>* shared = nullptr) {
+    return readObject(js, js.classes_.getClass(typeid(*old)), js.getCheckedClass(typeid(E)),
+                      objptr, cr, objectAddress(old), s, shared, true);
+  }
+  
+  // reuses an object pointed by a raw pointer.
+  template <class E>
+  inline typename std::enable_if<is_defobject<E>::value,bool>::type
+  reusePointee(JsonSerial& js, E*& ptr, ObjectPtr*& objptr, MetaClass::Creator* cr, const std::string& s) {
+    void* p = reuseObject(js, ptr, objptr, cr, s);
+    if (p != objectAddress(ptr)) ptr = static_cast<E*>(p);
+    return true;
+  }
+  
+  // reuses an object pointed by a unique_ptr.
+  template <class E>
+  inline typename std::enable_if<is_defobject<E>::value,bool>::type
+  reusePointee(JsonSerial& js, std::unique_ptr<E>& ptr, ObjectPtr*& objptr, MetaClass::Creator* cr,
+               const std::string& s) {
+    js.heap_next_ = true;   // if created: will be deleted by ptr
+    void* p = reuseObject(js, ptr.get(), objptr, cr, s);
+    if (p != objectAddress(ptr.get())) ptr.reset(static_cast<E*>(p));
+    return true;
+  }
+  
+  // reuses an object pointed by a shared_ptr.
+  template <class E>
+  inline typename std::enable_if<is_defobject<E>::value,bool>::type
+  reusePointee(JsonSerial& js, std::shared_ptr<E>& ptr, ObjectPtr*& objptr, MetaClass::Creator* cr,
+               const std::string& s) {
+    std::shared_ptr<void> owner = ptr;   // replaced if another object is created
+    void* p = reuseObject(js, ptr.get(), objptr, cr, s, &owner);
+    if (p != objectAddress(ptr.get())) setShared(js, ptr, static_cast<E*>(p), owner, objptr);
+    return true;
+  }
+  
+  // reuses a non-object pointee (e.g. a container) if it was not already reused.
+  template <class P>
+  inline typename std::enable_if<!is_defobject<typename std::remove_reference<decltype(*std::declval<P>())>::type>::value,bool>::type
+  reusePointee(JsonSerial& js, P& ptr, ObjectPtr*&, MetaClass::Creator*, const std::string& s) {
+    if (!js.reused_.insert(&*ptr).second) return false;
+    readValue(js, *ptr, s);
+    return true;
+  }
+  
+  /* in patch mode, patches the pointee of a non-null (raw or smart) pointer instead of
+   * replacing it. In reuse mode, reads it into the existing pointee if possible (see
+   * reuseObject()). Returns false if the pointer must be read as usual.
+   */
+  template <class P>
+  inline bool patchPointer(JsonSerial& js, P& ptr, const std::string& s,
+                           ObjectPtr*& objptr, MetaClass::Creator* cr) {
+    if (!ptr || (s != "{" && s != "[")) return false;
+    if (js.patching_) {
+      patchPointee<typename std::remove_reference<decltype(*ptr)>::type>(js, *ptr, s);
+      return true;
+    }
+    return js.reuse_ && reusePointee(js, ptr, objptr, cr, s);
+  }
+  
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   
   // reads a smart pointer.
@@ -126,15 +227,109 @@ namespace jsonserial {
   inline void readValue2(JsonSerial& js,
                          typename std::enable_if<is_smart_ptr<T>::value,T>::type & ptr,
                          const std::string& s) {
-    ptr = nullptr;
     ObjectPtr* objptr{nullptr};
-    if (s != "null") readPointee<T>(js, ptr, objptr, nullptr, s);
+    if (patchPointer(js, ptr, s, objptr, nullptr)) return;
+    ptr = nullptr;
+    if (js.tokenType(s) != JsonSerial::NullToken) readPointee<T>(js, ptr, objptr, nullptr, s);
   }
   
-  // reads a number of another type than int, long, etc.
+  // converts s to an integral number, returns false if s is not a number or is out of range.
+  // used by both readInteger() and validateInteger() so that they accept the same values.
+  template <class T>
+  inline typename std::enable_if<std::is_signed<T>::value,bool>::type
+  parseInteger(const std::string& s, T& var) {
+    char* end{nullptr};
+    errno = 0;
+    long long val = std::strtoll(s.c_str(), &end, 10);
+    if (end == s.c_str() || errno == ERANGE
+        || val < (long long)std::numeric_limits<T>::min()
+        || val > (long long)std::numeric_limits<T>::max()) return false;
+    var = T(val);
+    return true;
+  }
+
+  template <class T>
+  inline typename std::enable_if<std::is_unsigned<T>::value,bool>::type
+  parseInteger(const std::string& s, T& var) {
+    char* end{nullptr};
+    errno = 0;
+    unsigned long long val = std::strtoull(s.c_str(), &end, 10);
+    if (end == s.c_str() || errno == ERANGE
+        || val > (unsigned long long)std::numeric_limits<T>::max()) return false;
+    var = T(val);
+    return true;
+  }
+
+  // reads an integral number, produces an error if s is not a number or is out of range.
+  template <class T>
+  inline typename std::enable_if<std::is_signed<T>::value,bool>::type
+  readInteger(JsonSerial& js, T& var, const std::string& s) {
+    unsigned long long abs{0};
+    bool neg{false};
+    if (js.integerToken(s, abs, neg)) {  // already converted by the tokenizer
+      if (abs <= (unsigned long long)std::numeric_limits<T>::max()) {var = neg ? -T(abs) : T(abs); return true;}
+      if (neg && abs - 1 == (unsigned long long)std::numeric_limits<T>::max()) {
+        var = std::numeric_limits<T>::min(); return true;
+      }
+      js.error(JsonError::InvalidValue, s+" should be a number");
+      return false;
+    }
+    if (parseInteger(s, var)) return true;
+    js.error(JsonError::InvalidValue, s+" should be a number");
+    return false;
+  }
+  
+  template <class T>
+  inline typename std::enable_if<std::is_unsigned<T>::value,bool>::type
+  readInteger(JsonSerial& js, T& var, const std::string& s) {
+    unsigned long long abs{0};
+    bool neg{false};
+    if (js.integerToken(s, abs, neg) && (!neg || abs == 0)) {
+      if (abs <= (unsigned long long)std::numeric_limits<T>::max()) {var = T(abs); return true;}
+      js.error(JsonError::InvalidValue, s+" should be a number");
+      return false;
+    }
+    if (parseInteger(s, var)) return true;
+    js.error(JsonError::InvalidValue, s+" should be a number");
+    return false;
+  }
+  
+  // converts s to a floating number, returns false if s is not a number.
+  // used by both readFloat() and validateFloat() so that they accept the same values.
+  template <class T>
+  inline bool parseFloat(const std::string& s, T& var, T (*strto)(const char*, char**)) {
+    char* end{nullptr};
+    T val = strto(s.c_str(), &end);
+    if (end == s.c_str()) return false;
+    var = val;
+    return true;
+  }
+
+  inline bool parseFloat(const std::string& s, float& var) {return parseFloat(s, var, std::strtof);}
+  inline bool parseFloat(const std::string& s, double& var) {return parseFloat(s, var, std::strtod);}
+  inline bool parseFloat(const std::string& s, long double& var) {return parseFloat(s, var, std::strtold);}
+
+  // reads a floating number, produces an error if s is not a number.
+  template <class T>
+  inline void readFloat(JsonSerial& js, T& var, const std::string& s) {
+    unsigned long long abs{0};
+    bool neg{false};
+    if (js.integerToken(s, abs, neg)) {var = neg ? -T(abs) : T(abs); return;}
+    if (!parseFloat(s, var)) js.error(JsonError::InvalidValue, s+" should be a number");
+  }
+  
+  // reads an integral number of another type than int, long, etc.
+  template <class T>
+  inline void readValue2(JsonSerial& js,
+                         typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 1),T>::type & val,
+                         const std::string& s) {
+    readInteger(js, val, s);
+  }
+  
+  // reads a signed or unsigned char.
   template <class T>
   inline void readValue2(JsonSerial& js,
-                         typename std::enable_if<std::is_arithmetic<T>::value,T>::type & val,
+                         typename std::enable_if<std::is_arithmetic<T>::value && (sizeof(T) == 1),T>::type & val,
                          const std::string& s) {
     std::istringstream ss(s);
     ss.imbue(js.locale_);
@@ -146,7 +341,8 @@ namespace jsonserial {
   inline void readValue2(JsonSerial& js,
                          typename std::enable_if<std::is_enum<T>::value,T>::type & e,
                          const std::string& s) {
-    e = T(std::stoi(s));
+    int val{0};
+    if (readInteger(js, val, s)) e = T(val);
   }
   
   // reads a defobject.
@@ -159,12 +355,20 @@ namespace jsonserial {
     readObject(js, wanted_class, wanted_class, objptr, nullptr, &obj, s);
   }
   
+  // reads an object that has its own JSON format.
+  template <class T>
+  inline void readValue2(JsonSerial& js,
+                         typename std::enable_if<has_custom_format<T>::value,T>::type & obj,
+                         const std::string& s) {
+    obj.readJson(js, s);
+  }
+  
   // reads a map.
   template <class T>
   inline void readValue2(JsonSerial& js,
                          typename std::enable_if<is_std_map<T>::value,T>::type & obj,
                          const std::string& s) {
-    MapClass<T> wanted_class;
+    MapClass<T> wanted_class(js.reuse_ && !js.patching_, js.patching_);
     ObjectPtr* objptr{nullptr};
     readObject(js, &wanted_class, &wanted_class, objptr, nullptr, &obj, s);
   }
@@ -192,14 +396,22 @@ namespace jsonserial {
   // reads a string
   inline void readValue(JsonSerial&, std::string& var, const std::string& s) {var = s;}
   
-  inline void readValue(JsonSerial&, char*& var, const std::string& s) {
-    var = (s == "null" || !s.c_str()) ? nullptr : ::strdup(s.c_str());
+  inline void readValue(JsonSerial& js, char*& var, const std::string& s) {
+    var = (js.tokenType(s) == JsonSerial::NullToken) ? nullptr : js.copyString(s);
   }
   
-  inline void readValue(JsonSerial&, const char*& var, const std::string& s) {
-    var = (s == "null" || !s.c_str()) ? nullptr : ::strdup(s.c_str());
+  inline void readValue(JsonSerial& js, const char*& var, const std::string& s) {
+    var = (js.tokenType(s) == JsonSerial::NullToken) ? nullptr : js.copyString(s);
   }
   
+#if __cplusplus >= 201703L
+  // reads a string view (requires a string buffer).
+  inline void readValue(JsonSerial& js, std::string_view& var, const std::string& s) {
+    if (!js.strings_) js.error(JsonError::NoStringBuffer);
+    else var = std::string_view(js.strings_->store(s), s.size());
+  }
+#endif
+  
   // reads a char
   inline void readValue(JsonSerial&, char& var, const std::string& s) {
     var = s.empty() ? 0 : s[0];
@@ -207,29 +419,32 @@ namespace jsonserial {
   
   // reads a bool
   inline void readValue(JsonSerial& js, bool& var, const std::string& s) {
-    if (s == "true") var = true;
-    else if (s == "false") var = false;
+    JsonSerial::TokenType type = js.tokenType(s);
+    if (type == JsonSerial::StringToken) type = js.scanToken(s);  // quoted "true" or "false"
+    if (type == JsonSerial::TrueToken) var = true;
+    else if (type == JsonSerial::FalseToken) var = false;
     else js.error(JsonError::InvalidValue, s+" should be a boolean");
   }
   
   // reads an integral numebr
-  inline void readValue(JsonSerial&, int& var, const std::string& s) {var = std::stoi(s);}
-  inline void readValue(JsonSerial&, long& var, const std::string& s) {var = std::stol(s);}
-  inline void readValue(JsonSerial&, long long& var, const std::string& s) {var = std::stoll(s);}
-  inline void readValue(JsonSerial&, unsigned long& var, const std::string& s) {var = std::stoul(s);}
-  inline void readValue(JsonSerial&, unsigned long long& var, const std::string& s) {var = std::stoull(s);}
+  inline void readValue(JsonSerial& js, int& var, const std::string& s) {readInteger(js, var, s);}
+  inline void readValue(JsonSerial& js, long& var, const std::string& s) {readInteger(js, var, s);}
+  inline void readValue(JsonSerial& js, long long& var, const std::string& s) {readInteger(js, var, s);}
+  inline void readValue(JsonSerial& js, unsigned long& var, const std::string& s) {readInteger(js, var, s);}
+  inline void readValue(JsonSerial& js, unsigned long long& var, const std::string& s) {readInteger(js, var, s);}
   
   // reads a floating number
-  inline void readValue(JsonSerial&, float& var, const std::string& s) {var = std::stof(s);}
-  inline void readValue(JsonSerial&, double& var, const std::string& s) {var = std::stod(s);}
-  inline void readValue(JsonSerial&, long double& var, const std::string& s) {var = std::stold(s);}
+  inline void readValue(JsonSerial& js, float& var, const std::string& s) {readFloat(js, var, s);}
+  inline void readValue(JsonSerial& js, double& var, const std::string& s) {readFloat(js, var, s);}
+  inline void readValue(JsonSerial& js, long double& var, const std::string& s) {readFloat(js, var, s);}
   
   // reads a raw pointer.
   template <class T>
   inline void readValue(JsonSerial& js, T *& ptr, const std::string& s) {
-    ptr = nullptr;
     ObjectPtr* objptr{nullptr};
-    if (s != "null") readPointee<T>(js, ptr, objptr, nullptr, s);
+    if (patchPointer(js, ptr, s, objptr, nullptr)) return;
+    ptr = nullptr;
+    if (js.tokenType(s) != JsonSerial::NullToken) readPointee<T>(js, ptr, objptr, nullptr, s);
   }
   
   // reads a value of another type.
@@ -250,55 +465,97 @@ namespace jsonserial {
   inline void* readObject(JsonSerial& js,
                           const MetaClass* objclass, const MetaClass* pointerclass,
                           ObjectPtr*& jsp, MetaClass::Creator* cr, void* obj,
-                          const std::string& s) {
-    if (s.empty()) js.error(JsonError::ExpectingBrace);
+                          const std::string& s, std::shared_ptr<void>* shared, bool reusing) {
+    bool heap = js.heap_next_;   // don't create in arena (pointed by a unique_ptr)
+    js.heap_next_ = false;
+    if (s.empty()) {js.error(JsonError::ExpectingBrace); return nullptr;}
     else if (s[0] == '@') {  // shared object
       auto it = js.id_to_object_.find(std::strtoul(s.c_str()+1, nullptr, 0));
-      if (it == js.id_to_object_.end()) js.error(JsonError::InvalidID);
+      if (it == js.id_to_object_.end()) {js.error(JsonError::InvalidID); return nullptr;}
       jsp = &it->second;
       return obj = it->second.raw_;
     }
-    else if (s != "{") js.error(JsonError::ExpectingBrace);
+    else if (s != "{") {js.error(JsonError::ExpectingBrace); return nullptr;}
     
+    size_t next{0};   // index of the next member (see readNextMember())
+    bool first{true};
     while (js.in_->good()) {
       std::string name, value;
       bool found1, found2;
+      JsonSerial::TokenScope scope{js};   // see tokenType()
       js.readLine(name, value, found1, found2, true);
-      if (!found1) js.error(JsonError::ExpectingPairOrBrace);
-      else if (!found2 && name != "}") js.error(JsonError::ExpectingPairOrBrace);
+      if (js.failed()) return nullptr;
+      if (!found1 || (!found2 && name != "}")) {js.error(JsonError::ExpectingPairOrBrace); return nullptr;}
       
-      if (name[0]=='@' && name != "@class" && name != "@id")
+      if (name[0]=='@' && name != "@class" && name != "@id") {
         js.error(JsonError::WrongKeyword, value);
+        return nullptr;
+      }
+      
+      if (reusing) {  // existing object (reuse mode): replaced if it hasn't the same class
+        reusing = false;
+        const MetaClass* cl = (name == "@class") ? js.classes_.getClass(value) : pointerclass;
+        if (!objclass || cl != objclass || !js.reused_.insert(obj).second) {
+          objclass = nullptr;
+          obj = nullptr;
+          if (shared) shared->reset();
+        }
+      }
+      
+      if (name == "@class" && objclass && obj) {  // existing object (patch mode)
+        if (value != objclass->classname()) {
+          js.error(JsonError::InvalidValue, "@class: " + value);
+          return nullptr;
+        }
+        continue;
+      }
       
       if (!objclass) {  // search class
         if (name != "@class") objclass = pointerclass;
         else { // polymorphism
           objclass = js.classes_.getClass(value);
-          if (!objclass) js.error(JsonError::UnknownClass, value);
+          if (!objclass) {js.error(JsonError::UnknownClass, value); return nullptr;}
         }
+        if (js.failed()) return nullptr;  // unknown pointerclass
         if (!obj) { // create object if it does not exist
-          if (cr) obj = cr->create();
-          else obj = objclass->create();
+          JsonArena* arena = heap ? nullptr : js.arena_.get();
+          if (cr) {
+            obj = cr->create();
+            if (obj && arena) objclass->adopt(*arena, obj);
+          }
+          else if (shared) {  // pointed by a shared_ptr: object and counter allocated at once
+            *shared = objclass->createShared(js.arena_.get());
+            obj = shared->get();
+          }
+          if (!obj && !cr) obj = arena ? objclass->create(*arena) : objclass->create();
         }
-        if (!obj) js.error(JsonError::AbstractClass, objclass->classname());
+        if (!obj) {js.error(JsonError::AbstractClass, objclass->classname()); return nullptr;}
         if (name == "@class") continue;
       }
       
+      if (first) {   // unknown members are replaced, except when patching
+        first = false;
+        if (!js.patching_) objclass->clearUnknowns(obj);
+      }
       if (name == "}") {objclass->doPostRead(obj); return obj;}  // end of object
       else if (name == "@id") {  // id of object
-        jsp = &js.id_to_object_[std::stoul(value)];
+        char* end{nullptr};
+        unsigned long id = std::strtoul(value.c_str(), &end, 10);
+        if (end == value.c_str()) {
+          js.error(JsonError::InvalidValue, value+" for member '@id'");
+          return nullptr;
+        }
+        jsp = &js.id_to_object_[id];
         jsp->raw_ = obj;
+        jsp->class_ = objclass;
+        if (shared && *shared) jsp->shared_ = *shared;
         continue;
       }
-      else try {
-        if (!objclass->readMember(js, obj, name, value))
-          js.error(JsonError::UnknownMember,
-                   "'" +name + "' in class '" + objclass->classname()+"'",
-                   false/*not fatal*/);
-      }
-      catch (std::invalid_argument) {
-        js.error(JsonError::InvalidValue, value+" for member '"+name+"'");
+      else if (!objclass->readNextMember(js, obj, name, value, next)) {
+        js.memberError(JsonError::UnknownMember, objclass->classname(), name, false/*not fatal*/);
+        js.readRaw(nullptr, value);   // skips the value
       }
+      if (js.failed()) return nullptr;
     }
     js.error(JsonError::PrematureEOF);
     return nullptr;
@@ -310,15 +567,19 @@ namespace jsonserial {
   inline void readArray(JsonSerial& js,
                         JsonArray& a, MetaClass::Creator* cr,
                         const std::string& s) {
-    if (s != "[") js.error(JsonError::ExpectingBracket);
+    if (s != "[") {js.error(JsonError::ExpectingBracket); return;}
+    a.begin(js);
     while (js.in_->good()) {
       std::string tok, dump;
       bool found1, found2;
+      JsonSerial::TokenScope scope{js};   // see tokenType()
       js.readLine(tok, dump, found1, found2, false);
-      if (!found1) js.error(JsonError::ExpectingValueOrBracket);
+      if (js.failed()) return;
+      if (!found1) {js.error(JsonError::ExpectingValueOrBracket); return;}
       else if (tok == "]") {a.end(js); return;} // end of array
       //else if (tok == "null");  // null element ignored
       else a.add(js, cr, tok);
+      if (js.failed()) return;
     }
   }
   
@@ -328,8 +589,9 @@ namespace jsonserial {
                               typename std::enable_if<is_smart_ptr<T>::value,T>::type & e,
                               ObjectPtr*& objptr, MetaClass::Creator* cr,
                               const std::string& s) {
+    if (patchPointer(js, e, s, objptr, cr)) return;
     e.reset();
-    if (s != "null") readPointee<T>(js, e, objptr, cr, s);
+    if (js.tokenType(s) != JsonSerial::NullToken) readPointee<T>(js, e, objptr, cr, s);
   }
   
   // reads anything else in an array/container.
@@ -362,8 +624,9 @@ namespace jsonserial {
   inline void readArrayValue(JsonSerial& js,
                              T *& e, ObjectPtr*& objptr, MetaClass::Creator* cr,
                              const std::string& s) {
+    if (patchPointer(js, e, s, objptr, cr)) return;
     e = nullptr;
-    if (s != "null") readPointee<T>(js, e, objptr, cr, s);
+    if (js.tokenType(s) != JsonSerial::NullToken) readPointee<T>(js, e, objptr, cr, s);
   }
   
   // reads anything in an array/container except a char* or a raw pointer.
@@ -373,7 +636,326 @@ namespace jsonserial {
                              const std::string& s) {
     readArrayValue2<T>(js, e, objptr, cr, s);
   }
-  
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  // Validation: checks that s is a valid value for type T without creating anything.
+  // T is given by the (null) pointer argument. Functions return false if s has not
+  // the appropriate type, errors inside objects and arrays are reported directly.
+
+  template <class T>
+  inline bool validateValue(JsonSerial& js, T*, const std::string& s);
+
+  // checks any value (syntax only), skips it if it is an object or an array.
+  inline void validateAny(JsonSerial& js, const std::string& s) {
+    std::string name, value;
+    bool found1, found2;
+    JsonSerial::TokenScope scope{js};   // see tokenType()
+    if (s == "{") {
+      while (js.in_->good()) {
+        js.readLine(name, value, found1, found2, true);
+        if (js.failed()) return;
+        if (!found1 || (!found2 && name != "}")) {js.error(JsonError::ExpectingPairOrBrace); return;}
+        else if (name == "}") return;
+        else validateAny(js, value);
+      }
+      js.error(JsonError::PrematureEOF);
+    }
+    else if (s == "[") {
+      while (js.in_->good()) {
+        js.readLine(value, name, found1, found2, false);
+        if (js.failed()) return;
+        if (!found1) {js.error(JsonError::ExpectingValueOrBracket); return;}
+        else if (value == "]") return;
+        else validateAny(js, value);
+      }
+      js.error(JsonError::PrematureEOF);
+    }
+  }
+
+  // returns false (and skips the value) if s is an object or an array.
+  inline bool validateScalar(JsonSerial& js, const std::string& s) {
+    if (s != "{" && s != "[") return true;
+    validateAny(js, s);
+    return false;
+  }
+
+  // accepts the same values as readInteger() (e.g. 1.5 is truncated by read()).
+  template <class T>
+  inline bool validateInteger(const std::string& s) {
+    T val{};
+    return parseInteger(s, val);
+  }
+
+  // accepts the same values as readFloat() (e.g. out of range values become infinite).
+  template <class T>
+  inline bool validateFloat(const std::string& s) {
+    T val{};
+    return parseFloat(s, val);
+  }
+
+  /* checks a defobject or a map.
+   * - objclass : class of the object, null if the object would be created (see below)
+   * - pointerclass : class of the pointer, used as a default if no @class field
+   * - create : true if the object would be created by its class (not by a creator)
+   */
+  inline bool validateObject(JsonSerial& js,
+                             const MetaClass* objclass, const MetaClass* pointerclass,
+                             bool create, const std::string& s) {
+    if (s.empty()) return false;
+    else if (s[0] == '@') {  // shared object
+      if (js.id_to_object_.find(std::strtoul(s.c_str()+1, nullptr, 0)) == js.id_to_object_.end())
+        js.error(JsonError::InvalidID, s, false);
+      return true;
+    }
+    else if (s != "{") {validateAny(js, s); return false;}
+
+    bool first = !objclass;
+    std::string name, value;
+    bool found1, found2;
+    JsonSerial::TokenScope scope{js};   // see tokenType()
+    while (js.in_->good()) {
+      js.readLine(name, value, found1, found2, true);
+      if (js.failed()) return false;
+      if (!found1 || (!found2 && name != "}")) {js.error(JsonError::ExpectingPairOrBrace); return false;}
+
+      if (first) {  // search class
+        first = false;
+        if (name != "@class") objclass = pointerclass;
+        else { // polymorphism
+          objclass = js.classes_.getClass(value);
+          if (!objclass) js.error(JsonError::UnknownClass, value, false);
+        }
+        if (objclass && create && !objclass->hasCreator())
+          js.error(JsonError::AbstractClass, objclass->classname(), false);
+        if (name == "@class") continue;
+      }
+
+      if (name == "}") return true;  // end of object
+      else if (name == "@id") {  // id of object
+        char* end{nullptr};
+        unsigned long id = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != 0) js.error(JsonError::InvalidID, value, false);
+        else if (js.id_to_object_.find(id) != js.id_to_object_.end())
+          js.error(JsonError::DuplicateID, value, false);
+        else js.id_to_object_[id];
+      }
+      else if (name[0] == '@') {
+        js.error(JsonError::WrongKeyword, name, false);
+        validateAny(js, value);
+      }
+      else if (!objclass) validateAny(js, value);  // unknown class: can't check members
+      else if (!objclass->validateMember(js, name, value)) {
+        js.memberError(JsonError::UnknownMember, objclass->classname(), name, false);
+        validateAny(js, value);
+      }
+      if (js.failed()) return false;
+    }
+    js.error(JsonError::PrematureEOF);
+    return false;
+  }
+
+  // checks a non-object pointee.
+  template <class T>
+  inline bool validatePointee(JsonSerial& js,
+                              typename std::enable_if<!is_defobject<T>::value,bool>::type,
+                              const std::string& s) {
+    return validateValue(js, static_cast<T*>(nullptr), s);
+  }
+
+  // checks an object pointee.
+  template <class T>
+  inline bool validatePointee(JsonSerial& js,
+                              typename std::enable_if<is_defobject<T>::value,bool>::type create,
+                              const std::string& s) {
+    return validateObject(js, nullptr, js.getCheckedClass(typeid(T)), create, s);
+  }
+
+  // is this a pointer (raw or smart) to an object that can be created (not a C string)?
+  template <class E> struct is_pointee_ptr {
+    static constexpr bool value = (std::is_pointer<E>::value || is_smart_ptr<E>::value)
+    && !std::is_same<E, char*>::value && !std::is_same<E, const char*>::value;
+  };
+
+  // checks a pointer (raw or smart) in an array/container.
+  template <class E>
+  inline typename std::enable_if<is_pointee_ptr<E>::value,bool>::type
+  validateElement(JsonSerial& js, bool create, const std::string& s) {
+    using P = typename std::remove_pointer<typename make_pointer<E>::type>::type;
+    return js.tokenType(s) == JsonSerial::NullToken || validatePointee<P>(js, create, s);
+  }
+
+  // checks anything else in an array/container.
+  template <class E>
+  inline typename std::enable_if<!is_pointee_ptr<E>::value,bool>::type
+  validateElement(JsonSerial& js, bool, const std::string& s) {
+    return validateValue(js, static_cast<E*>(nullptr), s);
+  }
+
+  /* checks a C++ container or a C-array.
+   * - maxsize : maximum number of elements (0 if no limit)
+   * - create : true if pointees would be created by their class (not by a creator)
+   */
+  template <class E>
+  inline bool validateArray(JsonSerial& js, size_t maxsize, bool create, const std::string& s) {
+    if (s != "[") {validateAny(js, s); return false;}
+    std::string tok, dump;
+    bool found1, found2;
+    JsonSerial::TokenScope scope{js};   // see tokenType()
+    size_t count{0};
+    while (js.in_->good()) {
+      js.readLine(tok, dump, found1, found2, false);
+      if (js.failed()) return false;
+      if (!found1) {js.error(JsonError::ExpectingValueOrBracket); return false;}
+      else if (tok == "]") return true;  // end of array
+      else if (maxsize > 0 && ++count > maxsize) {
+        if (count == maxsize+1) js.error(JsonError::CantAddToArray, "", false);
+        validateAny(js, tok);
+      }
+      else if (!validateElement<E>(js, create, tok))
+        js.error(JsonError::InvalidValue, tok+" in array", false);
+      if (js.failed()) return false;
+    }
+    js.error(JsonError::PrematureEOF);
+    return false;
+  }
+
+  // capacity of a std::array, 0 for other containers.
+  template <class T>
+  inline typename std::enable_if<is_std_array<T>::value,size_t>::type arrayCapacity()
+  {return std::tuple_size<T>::value;}
+
+  template <class T>
+  inline typename std::enable_if<!is_std_array<T>::value,size_t>::type arrayCapacity()
+  {return 0;}
+
+  // checks an integral number (bool and char excepted).
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<std::is_integral<T>::value,bool>::type,
+                             const std::string& s) {
+    return validateScalar(js, s) && validateInteger<T>(s);
+  }
+
+  // checks a floating number.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<std::is_floating_point<T>::value,bool>::type,
+                             const std::string& s) {
+    return validateScalar(js, s) && validateFloat<T>(s);
+  }
+
+  // checks an enum.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<std::is_enum<T>::value,bool>::type,
+                             const std::string& s) {
+    return validateScalar(js, s) && validateInteger<int>(s);
+  }
+
+  // checks a raw pointer.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<std::is_pointer<T>::value,bool>::type,
+                             const std::string& s) {
+    return js.tokenType(s) == JsonSerial::NullToken || validatePointee<typename std::remove_pointer<T>::type>(js, true, s);
+  }
+
+  // checks a smart pointer.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<is_smart_ptr<T>::value,bool>::type,
+                             const std::string& s) {
+    return js.tokenType(s) == JsonSerial::NullToken || validatePointee<typename T::element_type>(js, true, s);
+  }
+
+  // checks a defobject.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<is_defobject<T>::value,bool>::type,
+                             const std::string& s) {
+    const MetaClass* wanted_class = js.getCheckedClass(typeid(T));
+    return validateObject(js, wanted_class, wanted_class, false, s);
+  }
+
+  // checks an object that has its own JSON format.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<has_custom_format<T>::value,bool>::type,
+                             const std::string& s) {
+    return T::validateJson(js, s);
+  }
+
+  // checks a map.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<is_std_map<T>::value,bool>::type,
+                             const std::string& s) {
+    MapClass<T> wanted_class;
+    return validateObject(js, &wanted_class, &wanted_class, false, s);
+  }
+
+  // checks a C-array.
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<std::is_array<T>::value,bool>::type,
+                             const std::string& s) {
+    return validateArray<typename std::remove_extent<T>::type>(js, std::extent<T>::value, true, s);
+  }
+
+  // checks an array_style container
+  template <class T>
+  inline bool validateValue2(JsonSerial& js,
+                             typename std::enable_if<has_array_format<T>::value,bool>::type,
+                             const std::string& s) {
+    return validateArray<typename T::value_type>(js, arrayCapacity<T>(), true, s);
+  }
+
+  // - - -
+
+  // checks a string.
+  inline bool validateValue(JsonSerial& js, std::string*, const std::string& s) {
+    return validateScalar(js, s);
+  }
+
+  inline bool validateValue(JsonSerial& js, char**, const std::string& s) {
+    return validateScalar(js, s);
+  }
+
+  inline bool validateValue(JsonSerial& js, const char**, const std::string& s) {
+    return validateScalar(js, s);
+  }
+
+#if __cplusplus >= 201703L
+  inline bool validateValue(JsonSerial& js, std::string_view*, const std::string& s) {
+    return validateScalar(js, s);
+  }
+#endif
+
+  // checks a char (read() keeps the first character of a longer string).
+  inline bool validateValue(JsonSerial& js, char*, const std::string& s) {
+    return validateScalar(js, s);
+  }
+
+  // checks a bool.
+  inline bool validateValue(JsonSerial& js, bool*, const std::string& s) {
+    JsonSerial::TokenType type = js.tokenType(s);
+    if (type == JsonSerial::StringToken) type = js.scanToken(s);  // quoted "true" or "false"
+    return validateScalar(js, s) && (type == JsonSerial::TrueToken || type == JsonSerial::FalseToken);
+  }
+
+  // checks a value of another type.
+  template <class T>
+  inline bool validateValue(JsonSerial& js, T*, const std::string& s) {
+    return validateValue2<T>(js, true, s);
+  }
+
+  // checks the value of a member, reports an error if it is not valid.
+  template <class T>
+  inline void validateMemberValue(JsonSerial& js, const std::string& name, const std::string& s) {
+    if (!validateValue(js, static_cast<T*>(nullptr), s))
+      js.error(JsonError::InvalidValue, s+" for member '"+name+"'", false);
+  }
+
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
@@ -390,13 +972,16 @@ namespace jsonserial {
   template <typename T, typename Var>
   struct StaticMember : public ObjectClass<T>::Member {
     StaticMember(const std::string& name, Var& var)
-    : ObjectClass<T>::Member(name), variable_(var) {}
+    : ObjectClass<T>::Member(name, typeid(Var)), variable_(var) {}
     
     void read(JsonSerial& js, T&, const std::string& val) override
     {readValue(js, variable_, val);}
     
     void write(JsonSerial& js, const T&) override
     {js.writeValue(variable_);}
+
+    void validate(JsonSerial& js, const std::string& val) override
+    {validateMemberValue<Var>(js, this->name_, val);}
   
   protected:
     Var& variable_;
@@ -405,13 +990,16 @@ namespace jsonserial {
   template <typename T, typename Var>
   struct InstanceMember : public ObjectClass<T>::Member {
     InstanceMember(const std::string& name, Var T::* var)
-    : ObjectClass<T>::Member(name), variable_(var) {}
+    : ObjectClass<T>::Member(name, typeid(Var)), variable_(var) {}
     
     void read(JsonSerial& js, T& obj, const std::string& val) override
     {readValue(js, obj.*variable_, val);}
     
     void write(JsonSerial& js, const T& obj) override
     {js.writeValue(obj.*variable_);}
+
+    void validate(JsonSerial& js, const std::string& val) override
+    {validateMemberValue<Var>(js, this->name_, val);}
   
   protected:
     Var T::* variable_;
@@ -420,13 +1008,16 @@ namespace jsonserial {
   template <typename T, typename Var>
   struct InstanceMemberWithCond : public ObjectClass<T>::Member {
     InstanceMemberWithCond(const std::string& name, Var T::* var, std::function<bool(const T&)> write_if)
-    : ObjectClass<T>::Member(name), variable_(var), write_if_(write_if) {}
+    : ObjectClass<T>::Member(name, typeid(Var)), variable_(var), write_if_(write_if) {}
     
     void read(JsonSerial& js, T& obj, const std::string& val) override
     {readValue(js, obj.*variable_, val);}
     
     void write(JsonSerial& js, const T& obj) override
     {if ((write_if_)(obj)) js.writeValue(obj.*variable_);}
+
+    void validate(JsonSerial& js, const std::string& val) override
+    {validateMemberValue<Var>(js, this->name_, val);}
     
   protected:
     Var T::* variable_;
@@ -437,16 +1028,22 @@ namespace jsonserial {
   struct InstanceMemberWithCreator : public ObjectClass<T>::Member {
     InstanceMemberWithCreator(const std::string& name,
                               Var T::* var, std::function<R(T&)> creator)
-    : ObjectClass<T>::Member(name), variable_(var), creator_(creator) {}
+    : ObjectClass<T>::Member(name, typeid(Var)), variable_(var), creator_(creator) {}
     
     void read(JsonSerial& js, T& obj, const std::string& s) override {
       ObjectCreatorImpl<T,R> c(obj, creator_);
-      obj.*variable_ = nullptr;
       ObjectPtr* jsp{nullptr};
+      if (patchPointer(js, obj.*variable_, s, jsp, &c)) return;
+      obj.*variable_ = nullptr;
       using TObj = typename std::remove_pointer<Var>::type;
-      if (s != "null") readPointee<TObj>(js, (obj.*variable_), jsp, &c, s);
+      if (js.tokenType(s) != JsonSerial::NullToken) readPointee<TObj>(js, (obj.*variable_), jsp, &c, s);
     }
     void write(JsonSerial& js, const T& obj) override {js.writeValue(obj.*variable_);}
+    void validate(JsonSerial& js, const std::string& s) override {
+      using TObj = typename std::remove_pointer<typename make_pointer<Var>::type>::type;
+      if (js.tokenType(s) != JsonSerial::NullToken && !validatePointee<TObj>(js, false, s))
+        js.error(JsonError::InvalidValue, s+" for member '"+this->name_+"'", false);
+    }
   
   protected:
     Var T::* variable_;
@@ -457,7 +1054,7 @@ namespace jsonserial {
   struct ArrayMemberWithCreator : public ObjectClass<T>::Member {
     ArrayMemberWithCreator(const std::string& name,
                            Var T::* var, std::function<R(T&)> creator)
-    : ObjectClass<T>::Member(name), variable_(var), creator_(creator) {}
+    : ObjectClass<T>::Member(name, typeid(Var)), variable_(var), creator_(creator) {}
     
     void read(JsonSerial& js, T& obj, const std::string& s) override {
       ObjectCreatorImpl<T,R> c(obj, creator_);
@@ -465,6 +1062,11 @@ namespace jsonserial {
       readArray(js, a, &c, s);
     }
     void write(JsonSerial& js, const T& obj) override {js.writeValue(obj.*variable_);}
+    void validate(JsonSerial& js, const std::string& s) override {
+      size_t maxsize = std::is_array<Var>::value ? std::extent<Var>::value : arrayCapacity<Var>();
+      if (!validateArray<typename make_array_pointer<Var>::type>(js, maxsize, false, s))
+        js.error(JsonError::InvalidValue, s+" for member '"+this->name_+"'", false);
+    }
     
   protected:
     Var T::* variable_;
@@ -475,7 +1077,7 @@ namespace jsonserial {
   struct InstanceMemberWithAccessor : public ObjectClass<T>::Member  {
     InstanceMemberWithAccessor(const std::string& name,
                                void(T::*setter)(SetVal), GetVal(T::*getter)()const)
-    : ObjectClass<T>::Member(name), setter_(setter), getter_(getter) {}
+    : ObjectClass<T>::Member(name, typeid(SetVal)), setter_(setter), getter_(getter) {}
     
     void read(JsonSerial& js, T& obj, const std::string& val) override {
       typename std::remove_const<typename std::remove_reference<SetVal>::type>::type var;
@@ -484,6 +1086,11 @@ namespace jsonserial {
     }
     
     void write(JsonSerial& js, const T& obj) override {js.writeValue((obj.*getter_)());}
+
+    void validate(JsonSerial& js, const std::string& val) override {
+      validateMemberValue<typename std::remove_const<typename std::remove_reference<SetVal>::type>::type>
+      (js, this->name_, val);
+    }
     
   protected:
     void (T::*setter_)(SetVal);
@@ -569,6 +1176,7 @@ namespace jsonserial {
   template <typename Super>
   ObjectClass<T>& ObjectClass<T>::extends() {
     static_assert(std::is_base_of<Super, T>::value, "In call to superclass<S>(): S is not a superclass");
+    if (frozen("extends()")) return *this;
     const MetaClass* c = classes_.getClass(typeid(Super));
     if (!c) classes_.error(JsonError::UnknownSuperclass,
                            std::string(": superclass ")+typeid(Super).name()+" of class "+classname_, "extends()");
@@ -584,13 +1192,21 @@ namespace jsonserial {
   
   template <class T>
   void ObjectClass<T>::addMember(const std::string& name, Member* m) {
-    if (getMember(name))
+    if (frozen("member()")) delete m;
+    else if (getMember(name))
       classes_.error(JsonError::RedefinedMember,": member "+name+" of class "+classname_, "member()");
     else {
       members_.push_back(m); membermap_[name] = m;
     }
   }
   
+  template <class T>
+  bool ObjectClass<T>::frozen(const char* where) const {
+    if (!classes_.isFrozen()) {classes_.modified(); return false;}
+    classes_.error(JsonError::FrozenClasses, ": class "+classname_, where);
+    return true;
+  }
+  
   template <class T>
   typename ObjectClass<T>::Member* ObjectClass<T>::getMember(const std::string& name) const {
     auto it = membermap_.find(name);
@@ -606,20 +1222,82 @@ namespace jsonserial {
     for (auto& it : superclasses_) {    // if not found, search in superclasses
       if (it.super_->readMember(js, (it.upcast_)(obj), name, val)) return true;
     }
+    if (unknowns_) {    // keep the unknown member
+      std::string raw;
+      js.readRaw(&raw, val);
+      (static_cast<T*>(obj)->*unknowns_).add(name, raw);
+      return true;
+    }
     return false;
   }
   
+  template <class T>
+  bool ObjectClass<T>::readNextMember(JsonSerial& js, void* obj, const std::string& name,
+                                      const std::string& val, size_t& next) const {
+    if (next < members_.size() && members_[next]->name() == name) {  // members are usually in order
+      members_[next++]->read(js, *static_cast<T*>(obj), val);
+      return true;
+    }
+    return readMember(js, obj, name, val);
+  }
+  
+  // removes the unknown members of the object and of its superclasses.
+  template <class T>
+  void ObjectClass<T>::clearUnknowns(void* obj) const {
+    if (unknowns_) (static_cast<T*>(obj)->*unknowns_).clear();
+    for (auto& it : superclasses_) it.super_->clearUnknowns((it.upcast_)(obj));
+  }
+  
+  template <class T>
+  uint64_t ObjectClass<T>::fingerprint() const {
+    uint64_t h = hashString(classname_);
+    for (auto& it : superclasses_) h = hashString(it.super_->classname(), h);
+    for (auto& it : members_) h = hashString(it->typeName(), hashString(it->name(), h));
+    return h;
+  }
+  
+  template <class T>
+  bool ObjectClass<T>::validateMember(JsonSerial& js, const std::string& name, const std::string& val) const {
+    if (auto mb = getMember(name)) {    // search in subclass first
+      mb->validate(js, val);
+      return true;
+    }
+    for (auto& it : superclasses_) {    // if not found, search in superclasses
+      if (it.super_->validateMember(js, name, val)) return true;
+    }
+    if (unknowns_) {
+      validateAny(js, val);
+      return true;
+    }
+    return false;
+  }
+  
+  // custom members can't be checked without calling their read function.
+  template <class T>
+  void ObjectClass<T>::Member::validate(JsonSerial& js, const std::string& val) {
+    validateAny(js, val);
+  }
+  
   template <class T>
   void ObjectClass<T>::writeMembers(JsonSerial& js, const void* obj) const {
     for (auto& it : superclasses_) {    // print members in superclasses first
       it.super_->writeMembers(js, (it.upcast_)((void*)obj));
     }
     for (auto& it : members_) {  // then print members (can't be shadowed!)
+      js.markMember();
       if (js.needcomma_) *(js.out_) << ",\n"; js.needcomma_ = false;
       if (it->isCustom()) js.token1_ = it->name();
       else {js.writeTabs(); *(js.out_) << '"' << it->name() << "\": ";}
       it->write(js, *static_cast<const T*>(obj));
     }
+    if (unknowns_) {  // then members that were not declared
+      (static_cast<const T*>(obj)->*unknowns_).forEach([&js](const char* name, const char* value) {
+        js.markMember();
+        if (js.needcomma_) *(js.out_) << ",\n";
+        js.writeTabs(); js.writeString(name, false); *(js.out_) << ": ";
+        js.writeRaw(value);
+      });
+    }
   }
   
   template <class T>
@@ -637,7 +1315,30 @@ namespace jsonserial {
   template <class T>
   bool MapClass<T>::readMember(JsonSerial& js, void* map, const std::string& key, const std::string& val) const {
     using E = typename T::mapped_type;
-    readValue(js, (*static_cast<T*>(map))[key] = E{}, val);
+    E& value = (*static_cast<T*>(map))[key];
+    if (reuse_) seen_.push_back(&value); else if (!merge_) value = E{};
+    readValue(js, value, val);
+    return true;
+  }
+  
+  // removes the keys that were not read (reuse mode).
+  template <class T>
+  void MapClass<T>::doPostRead(void* obj) const {
+    if (!reuse_) return;
+    T& map = *static_cast<T*>(obj);
+    std::less<const void*> less;   // total order, unlike < for unrelated pointers
+    std::sort(seen_.begin(), seen_.end(), less);
+    for (auto it = map.begin(); it != map.end(); ) {
+      if (std::binary_search(seen_.begin(), seen_.end(), &it->second, less)) ++it;
+      else it = map.erase(it);
+    }
+    seen_.clear();
+  }
+  
+  template <class T>
+  bool MapClass<T>::validateMember(JsonSerial& js, const std::string& key, const std::string& val) const {
+    if (!validateValue(js, static_cast<typename T::mapped_type*>(nullptr), val))
+      js.error(JsonError::InvalidValue, val+" for key '"+key+"'", false);
     return true;
   }
   
@@ -653,9 +1354,15 @@ namespace jsonserial {
   
   template <class T>
   ObjectClass<T> & JsonClasses::defclass(const std::string& classname, std::function<T*()> creator) {
-    if (getClass(classname)) error(JsonError::RedefinedClass, classname, "defclass()");
     ObjectClass<T>* cl = new ObjectClass<T>(*this, classname, creator);
+    if (frozen_) {   // the class is not registered
+      error(JsonError::FrozenClasses, ": class "+classname, "defclass()");
+      rejected_.push_back(cl);
+      return *cl;
+    }
+    if (getClass(classname)) error(JsonError::RedefinedClass, classname, "defclass()");
     classindexes_[std::type_index(typeid(T))] = classnames_[classname] = cl;
+    modified();
     return *cl;
   }
   
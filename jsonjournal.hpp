@@ -0,0 +1,234 @@
+//
+//  jsonjournal.hpp: must be included for using checkpoint journals
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_jsonjournal_hpp
+#define jsonserial_jsonjournal_hpp
+
+#include <cstdio>
+#include <jsonserial/jsondelta.hpp>
+
+namespace jsonserial {
+
+  /** Append-only checkpoint file.
+   * A journal is a JSON Lines file: its first line is a snapshot of a graph of objects
+   * and the following lines are the deltas that were appended by the next checkpoints
+   * (see JsonDelta). Each checkpoint thus only writes what has changed.
+   *
+   * The journal is compacted (i.e. replaced by a new snapshot) when the size of the deltas
+   * exceeds _ratio_ times the size of the snapshot. The new snapshot is written
+   * in a temporary file that then replaces the journal, so that the journal is always
+   * valid. An incomplete last line (e.g. if the program crashed while appending it)
+   * is ignored when the journal is read.
+   *
+   * On POSIX systems, the temporary file and its directory are synced to disk (with
+   * fsync()) when the journal is compacted, and each appended delta is synced unless
+   * setSync(false) was called. Other systems only flush the files: the journal is then
+   * not protected against a system crash (only against a crash of the program).
+   *
+   * A JsonJournal is used either for writing or for reading a graph of objects.
+   * After read(), the next write() compacts the journal.
+   *
+   * Example:
+   * @code
+   *   JsonJournal journal("contacts.journal");
+   *   journal.write(js, contacts);   // writes a snapshot
+   *   ...   // contacts are modified
+   *   journal.write(js, contacts);   // appends a delta
+   *
+   *   JsonJournal journal2("contacts.journal");
+   *   journal2.read(js2, contacts2);
+   * @endcode
+   */
+  class JsonJournal {
+  public:
+    /// _filename_ is the path of the journal.
+    JsonJournal(const std::string& filename, double ratio = 1.0)
+    : filename_(filename), ratio_(ratio) {}
+
+    JsonJournal(const JsonJournal&) = delete;
+    JsonJournal& operator=(const JsonJournal&) = delete;
+
+    /// Changes the size ratio of the deltas to the snapshot that triggers compaction.
+    void setRatio(double ratio) {ratio_ = ratio;}
+
+    /// Returns the size ratio that triggers compaction.
+    double getRatio() const {return ratio_;}
+
+    /** Syncs each appended delta to disk if _mode_ is true (the default).
+     *  Appending is faster without syncing, but the last deltas may then be lost
+     *  if the system crashes. Compacting always syncs the journal.
+     */
+    void setSync(bool mode = true) {sync_ = mode;}
+
+    /// Returns true if appended deltas are synced to disk.
+    bool getSync() const {return sync_;}
+
+    /// Returns the size of the snapshot and the size of the deltas (in bytes).
+    void getSizes(size_t& snapshot, size_t& deltas) const {snapshot = base_size_; deltas = deltas_size_;}
+
+    /** Appends the changes of the graph of objects to the journal.
+     *  The journal is compacted if there is no snapshot or if it has grown
+     *  past the ratio. Returns false and prints a message in case of an error
+     *  (see JsonSerial::JsonSerial()).
+     *  _root_ must be an object or a pointer to an object.
+     */
+    template <class T>
+    bool write(JsonSerial& js, const T& root) {
+      if (base_size_ == 0 || deltas_size_ > ratio_ * base_size_) return compact(js, root);
+      std::ostringstream buf;
+      if (!delta_.writeDelta(js, root, buf, filename_)) {base_size_ = 0; return false;}
+      std::string line = toLine(buf.str());
+      if (line == "[]") return true;   // nothing has changed
+      if (!writeFile(filename_, line + '\n', true, sync_)) {
+        base_size_ = 0;   // a new snapshot is needed
+        js.reset(filename_, 0, nullptr, nullptr);
+        JSONSERIAL_TRY {js.error(JsonError::CantWriteFile);} JSONSERIAL_CATCH(JsonError*) {}
+        return false;
+      }
+      deltas_size_ += line.size() + 1;
+      return true;
+    }
+
+    /** Replaces the journal by a snapshot of the graph of objects.
+     *  Arguments: see write().
+     */
+    template <class T>
+    bool compact(JsonSerial& js, const T& root) {
+      base_size_ = deltas_size_ = 0;
+      std::ostringstream buf;
+      if (!delta_.writeSnapshot(js, root, buf, filename_)) return false;
+      std::string line = toLine(buf.str());
+      std::string tmpname = filename_ + ".tmp";
+      if (!writeFile(tmpname, line + '\n', false, true)) {
+        js.reset(tmpname, 0, nullptr, nullptr);
+        JSONSERIAL_TRY {js.error(JsonError::CantWriteFile);} JSONSERIAL_CATCH(JsonError*) {}
+        return false;
+      }
+      // the directory is synced so that the renaming is durable
+      if (std::rename(tmpname.c_str(), filename_.c_str()) != 0 || !syncDirectory(filename_)) {
+        js.reset(filename_, 0, nullptr, nullptr);
+        JSONSERIAL_TRY {js.error(JsonError::CantWriteFile);} JSONSERIAL_CATCH(JsonError*) {}
+        return false;
+      }
+      base_size_ = line.size() + 1;
+      return true;
+    }
+
+    /** Reads the graph of objects by replaying the snapshot and the deltas.
+     *  Returns false and prints a message in case of an error (see JsonSerial::JsonSerial()).
+     *  _root_ must be an object or a pointer to an object.
+     */
+    template <class T>
+    bool read(JsonSerial& js, T& root) {
+      base_size_ = deltas_size_ = 0;   // the next write() compacts the journal
+      std::ifstream in(filename_);
+      if (!in) {
+        js.reset(filename_, 0, nullptr, nullptr);
+        JSONSERIAL_TRY {js.error(JsonError::CantReadFile);} JSONSERIAL_CATCH(JsonError*) {}
+        return false;
+      }
+      std::string line;
+      size_t lineno = 0;
+      while (std::getline(in, line) && !in.eof()) {  // an incomplete last line is ignored
+        JsonInputBuffer buf(line.data(), line.size());
+        std::istream input(&buf);
+        if (++lineno == 1) {
+          if (!delta_.readSnapshot(js, root, input, filename_, lineno)) return false;
+        }
+        else if (!delta_.readDelta(js, input, filename_, lineno)) return false;
+      }
+      if (lineno == 0) {
+        js.reset(filename_, 0, nullptr, nullptr);
+        JSONSERIAL_TRY {js.error(JsonError::NoData);} JSONSERIAL_CATCH(JsonError*) {}
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    // writes (or appends) _data_ to a file, and syncs the file if _sync_ is true (POSIX only).
+    static bool writeFile(const std::string& filename, const std::string& data, bool append, bool sync) {
+#if JSONSERIAL_POSIX
+      int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+      if (fd < 0) return false;
+      bool ok = true;
+      for (size_t k = 0; ok && k < data.size(); ) {
+        ssize_t n = ::write(fd, data.data() + k, data.size() - k);
+        if (n > 0) k += size_t(n); else if (n < 0 && errno != EINTR) ok = false;
+      }
+      if (ok && sync && ::fsync(fd) != 0) ok = false;
+      if (::close(fd) != 0) ok = false;
+      return ok;
+#else
+      (void)sync;
+      std::ofstream out(filename, append ? std::ios::app : std::ios::out);
+      return out && out << data << std::flush;
+#endif
+    }
+
+    // syncs the directory of a file (POSIX only).
+    static bool syncDirectory(const std::string& filename) {
+#if JSONSERIAL_POSIX
+      size_t slash = filename.rfind('/');
+      std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+      int fd = ::open(dir.c_str(), O_RDONLY);
+      if (fd < 0) return false;
+      bool ok = ::fsync(fd) == 0;
+      return ::close(fd) == 0 && ok;
+#else
+      (void)filename;
+      return true;
+#endif
+    }
+
+    /* removes the newlines that are not in strings and escapes those that are in strings
+     * (the strings of RawJson and Lazy members that were read with the Newlines syntax
+     * can contain newlines) so that each delta is on a single line.
+     */
+    static std::string toLine(const std::string& json) {
+      std::string line;
+      line.reserve(json.size());
+      bool instring = false;
+      for (size_t k = 0; k < json.size(); ++k) {
+        char c = json[k];
+        if (instring) {
+          if (c == '\\' && k+1 < json.size()) {line += c; c = json[++k]; if (c == '\n') c = 'n';}
+          else if (c == '"') instring = false;
+          else if (c == '\n') {line += "\\n"; continue;}
+          else if (c == '\r') {line += "\\r"; continue;}
+        }
+        else if (c == '"') instring = true;
+        else if (c == '\n') continue;
+        line += c;
+      }
+      return line;
+    }
+
+    std::string filename_;
+    double ratio_;
+    bool sync_{true};
+    size_t base_size_{0}, deltas_size_{0};
+    JsonDelta delta_;
+  };
+
+}
+
+#endif
@@ -70,13 +70,13 @@
  *    class Classes : public JsonClasses {
  *      Classes() {
  *        defclass<Contact>("Contact")
- *         .member(&Contacts::firstname, "firstname")
- *         .member(&Contacts::lastname, "lastname")
- *         .member(&Contacts::numbers, "numbers");
+ *         .member("firstname", &Contacts::firstname)
+ *         .member("lastname", &Contacts::lastname)
+ *         .member("numbers", &Contacts::numbers);
  *
  *        defclass<PhoneNumber>("PhoneNumber")
- *         .member(&PhoneNumber::setType, &PhoneNumber::getType, "type")
- *         .member(&PhoneNumber::setNumber, &PhoneNumber::getNumber, "number");
+ *         .member("type", &PhoneNumber::setType, &PhoneNumber::getType)
+ *         .member("number", &PhoneNumber::setNumber, &PhoneNumber::getNumber);
  *    }
  *
  *    int main() {
@@ -101,21 +101,41 @@
 
 #include <string.h>
 #include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <limits>
 #include <locale>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <typeinfo>
 #include <typeindex>
 #include <utility>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <list>
+#include <deque>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include <jsonserial/jsondefs.hpp>
 #include <jsonserial/jsonerror.hpp>
+#include <jsonserial/jsonbuffers.hpp>
+#include <jsonserial/jsonarena.hpp>
+#include <jsonserial/jsonthreads.hpp>
 #include <jsonserial/jsonclasses.hpp>
 
 namespace jsonserial {
@@ -125,6 +145,9 @@ namespace jsonserial {
    * - jsonserial.hpp for explanations and an example.
    * - read() to read objects from a JSON file
    * - write() to write objects to a JSON file
+   * - writeAsync() to write objects to a JSON file in another thread
+   * - readMany() and writeMany() to read or write many files in parallel
+   * - validate() to check a JSON file without creating objects
    * - setSharing() to share objects whithout duplicating them
    * - setSyntax() to relax syntax.
    */
@@ -134,6 +157,14 @@ namespace jsonserial {
      *  _classes_ refers to the classes that have been registered for serialization.
      *  _handler_ is an optional error handler (can be a lambda or a static function).
      *  Errors are printed on std::cerr if no error handler is specified.
+     *
+     *  A JsonSerial should be reused for reading or writing many objects (e.g. small
+     *  messages): its buffers and tables are kept from one call to the next so that
+     *  no memory is allocated once they have reached their working size.
+     *  A JsonSerial is cheap to create but it must not be used by several threads
+     *  at the same time. Threads can share the same _classes_ once they are frozen
+     *  (see JsonClasses::freeze()), each of them using its own JsonSerial
+     *  (see also copySettings()).
      *  @see JsonSerial, JsonClasses, JsonError.
      */
     JsonSerial(const JsonClasses& classes, JsonError::Handler handler = nullptr)
@@ -141,6 +172,7 @@ namespace jsonserial {
     
     ~JsonSerial() {
       delete jsonerror_;
+      delete spareerror_;
     }
     
     /** Reads an object and its members recursively from a JSON file.
@@ -151,15 +183,15 @@ namespace jsonserial {
      */
     template <class T>
     bool read(T& object, const std::string& filename) {
-      try {
-        std::ifstream input(filename);
+      JSONSERIAL_TRY {
+        InputFile input(filename, readahead_);
         if (!input) {
           reset(filename, 0, nullptr, nullptr);
           error(JsonError::CantReadFile);
         }
         else if (!read(object, input, filename, 1)) return false;
       }
-      catch (JsonError* e) {return false;}
+      JSONSERIAL_CATCH(JsonError*) {return false;}
       return !jsonerror_;  // not null if warning
     }
     
@@ -174,17 +206,106 @@ namespace jsonserial {
      */
     template <class T>
     bool read(T& object, std::istream& in, const std::string& name = "", size_t line = 1) {
-      try {
+      JSONSERIAL_TRY {
         reset(name, line, &in, nullptr);
+        if (fingerprint_ && readFingerprint()) readline_ = &JsonSerial::readLine2<Trusted>;
         std::string keyword, dump;
         bool found1, found2;
+        TokenScope scope{*this};   // see tokenType()
         readLine(keyword, dump, found1, found2, true);
+        if (failed()) return false;
         if (found1) readValue(*this, object, keyword); else error(JsonError::NoData);
       }
-      catch (JsonError* e) {return false;}
+      JSONSERIAL_CATCH(JsonError*) {return false;}
+      return !jsonerror_;
+    }
+
+    /** Applies a partial JSON file to an existing object.
+     *  Same as read() except that:
+     *  - members that are not in the JSON file keep their values,
+     *  - containers are merged instead of being cleared: the elements of vectors,
+     *    deques and lists are overwritten by index (and added if the JSON array is
+     *    longer), the values of maps are overwritten by key, elements are added to sets,
+     *  - non-null pointers are not replaced: their pointees are patched.
+     *
+     *  An update thus only costs time proportional to the size of the patch.
+     *  Objects in arrays can be skipped by giving an empty JSON object: {}.
+     *  Arguments: see read(T&, const std::string&).
+     */
+    template <class T>
+    bool patch(T& object, const std::string& filename) {
+      JSONSERIAL_TRY {
+        InputFile input(filename, readahead_);
+        if (!input) {
+          reset(filename, 0, nullptr, nullptr);
+          error(JsonError::CantReadFile);
+        }
+        else if (!patch(object, input, filename, 1)) return false;
+      }
+      JSONSERIAL_CATCH(JsonError*) {return false;}
       return !jsonerror_;
     }
     
+    /** Applies a partial JSON document to an existing object.
+     *  See patch(T&, const std::string&) and read(T&, std::istream&, const std::string&, size_t).
+     */
+    template <class T>
+    bool patch(T& object, std::istream& in, const std::string& name = "", size_t line = 1) {
+      patching_ = true;
+      bool ok = read(object, in, name, line);
+      patching_ = false;
+      return ok;
+    }
+
+    /** Checks that a JSON file could be read as an object of type T.
+     *  The file is checked against the registered classes (class names, member names,
+     *  types and ranges of values, "@id" references) but no object is created and no
+     *  setter or creator function is called.
+     *  All errors are reported (see constructor for details), not only the first one,
+     *  except syntax errors that prevent checking the rest of the file.
+     *  Returns false if the file is not valid.
+     *  Arguments:
+     *  - _T_ (template argument): the type of the object (can be a pointer)
+     *  - _filename_: the path of the JSON file
+     */
+    template <class T>
+    bool validate(const std::string& filename) {
+      JSONSERIAL_TRY {
+        InputFile input(filename, readahead_);
+        if (!input) {
+          reset(filename, 0, nullptr, nullptr);
+          error(JsonError::CantReadFile);
+        }
+        else if (!validate<T>(input, filename, 1)) return false;
+      }
+      JSONSERIAL_CATCH(JsonError*) {return false;}
+      return !jsonerror_;
+    }
+
+    /** Checks that an input stream could be read as an object of type T.
+     *  See validate(const std::string&) for details.
+     *  Arguments:
+     *  - _T_ (template argument): the type of the object (can be a pointer)
+     *  - _in_: a valid input stream
+     *  - _name_ and _line_: see read(T&, std::istream&, const std::string&, size_t).
+     */
+    template <class T>
+    bool validate(std::istream& in, const std::string& name = "", size_t line = 1) {
+      JSONSERIAL_TRY {
+        reset(name, line, &in, nullptr);
+        std::string keyword, dump;
+        bool found1, found2;
+        TokenScope scope{*this};   // see tokenType()
+        readLine(keyword, dump, found1, found2, true);
+        if (failed()) return false;
+        else if (!found1) error(JsonError::NoData);
+        else if (!validateValue(*this, static_cast<T*>(nullptr), keyword))
+          error(JsonError::InvalidValue, keyword, false);
+      }
+      JSONSERIAL_CATCH(JsonError*) {return false;}
+      return !jsonerror_;
+    }
+
     /** Writes an object and its members recursively in a JSON file.
      *  Returns false an prints a message in case of an error (see constructor for details)
      *  Arguments:
@@ -193,15 +314,16 @@ namespace jsonserial {
      */
     template <class T>
     bool write(const T& object, const std::string& filename) {
-      try {
-        std::ofstream output(filename);
+      JSONSERIAL_TRY {
+        OutputFile output(filename, writebehind_);
         if (!output) {
           reset(filename, 0, nullptr, nullptr);
           error(JsonError::CantWriteFile);
         }
         else if (!write(object, output, filename, 1)) return false;
+        else if (!output.close()) error(JsonError::CantWriteFile);
       }
-      catch (JsonError* e) {return false;}
+      JSONSERIAL_CATCH(JsonError*) {return false;}
       return !jsonerror_;
     }
     
@@ -216,15 +338,108 @@ namespace jsonserial {
      */
     template <class T>
     bool write(const T& object, std::ostream& out, const std::string& name = "", size_t line = 1) {
-      try {
+      JSONSERIAL_TRY {
         reset(name, line, nullptr, &out);
+        if (fingerprint_) *out_ << "// jsonserial " << hexString(classes_.fingerprint()) << "\n";
         writeValue(object);
         *out_ << "\n" << std::endl;
       }
-      catch (JsonError* e) {return false;}
+      JSONSERIAL_CATCH(JsonError*) {return false;}
       return !jsonerror_;
     }
     
+    /** Writes an object and its members recursively in a JSON file asynchronously.
+     *  The object is serialized in memory by the calling thread, then the file is
+     *  written by another thread: the object can be modified as soon as this function
+     *  returns, but without waiting for the file to be written.
+     *  The returned future becomes ready when the file has been written, its value
+     *  is false in case of an error. Errors that occur while writing the file are
+     *  reported (see constructor) by the other thread. The file is written with the
+     *  write-behind option of this JsonSerial (see setWriteBehind()).
+     *  Note that, as with all futures returned by std::async(), the destructor
+     *  of the returned future waits until the file has been written: discarding it
+     *  makes this function synchronous.
+     *  Arguments: see write(const T&, const std::string&).
+     */
+    template <class T>
+    std::future<bool> writeAsync(const T& object, const std::string& filename) {
+      auto buf = std::make_shared<std::stringstream>();
+      if (!write(object, *buf, filename, 1)) {
+        std::promise<bool> failed;
+        failed.set_value(false);
+        return failed.get_future();
+      }
+      JsonError::Handler handler = errhandler_;
+      size_t writebehind = writebehind_;
+      return std::async(std::launch::async, [buf, filename, handler, writebehind]() {
+        OutputFile output(filename, writebehind);
+        if (output && output << buf->rdbuf() && output.close()) return true;
+        JsonError e;
+        e.set(JsonError::CantWriteFile, true, "write", "", filename, 0, handler);
+        return false;
+      });
+    }
+    
+    /** Writes a copy of an object in a JSON file asynchronously.
+     *  Same as writeAsync() except that the object is also serialized by the other
+     *  thread. _copy_ must thus be a snapshot of the data that is not shared with
+     *  objects that are modified meanwhile (e.g. if _copy_ is a pointer, the pointed
+     *  objects must not be modified). The JsonClasses of this JsonSerial must not be
+     *  modified before the future becomes ready. The object is written with the same
+     *  options as this JsonSerial (see copySettings()).
+     *  As for writeAsync(), the destructor of the returned future waits until the file
+     *  has been written.
+     *  Arguments: see write(const T&, const std::string&).
+     */
+    template <class T>
+    std::future<bool> writeCopyAsync(T copy, const std::string& filename) {
+      auto object = std::make_shared<T>(std::move(copy));
+      auto js = std::make_shared<JsonSerial>(classes_, errhandler_);
+      js->copySettings(*this);
+      return std::async(std::launch::async, [object, filename, js]() {
+        return js->write(*object, filename);
+      });
+    }
+    
+    /** Reads many objects from many JSON files in parallel.
+     *  Each file is read by a thread of _pool_ (or of a temporary pool with one thread
+     *  per core if _pool_ is null) as read(T&, const std::string&) would do,
+     *  with the same options as this JsonSerial (except the string buffer and the arena
+     *  that can't be shared between threads).
+     *  Returns the outcome of each file, in the same order as _files_: the type of the
+     *  JsonError is JsonError::OK if the file was read without error or warning.
+     *  Errors are not printed and the error handler is not called.
+     *  Arguments:
+     *  - _files_: the objects (can be pointers) and the paths of the JSON files
+     *  - _pool_: an optional thread pool
+     */
+    template <class T>
+    std::vector<JsonError> readMany(const std::vector<std::pair<T*, std::string>>& files,
+                                    JsonThreadPool* pool = nullptr) {
+      std::vector<JsonError> results(files.size());
+      forEachFile(files.size(), pool, [this, &files, &results](size_t k) {
+        JsonSerial js(classes_, [&results, k](const JsonError& e) {results[k] = e;});
+        js.copySettings(*this);
+        js.read(*files[k].first, files[k].second);
+      });
+      return results;
+    }
+    
+    /** Writes many objects in many JSON files in parallel.
+     *  Arguments and returned value: see readMany().
+     */
+    template <class T>
+    std::vector<JsonError> writeMany(const std::vector<std::pair<const T*, std::string>>& files,
+                                     JsonThreadPool* pool = nullptr) {
+      std::vector<JsonError> results(files.size());
+      forEachFile(files.size(), pool, [this, &files, &results](size_t k) {
+        JsonSerial js(classes_, [&results, k](const JsonError& e) {results[k] = e;});
+        js.copySettings(*this);
+        js.write(*files[k].first, files[k].second);
+      });
+      return results;
+    }
+    
     /// Returns the corresponding JsonClasses object.
     const JsonClasses& getClasses() const {return classes_;}
 
@@ -244,6 +459,70 @@ namespace jsonserial {
     /// Return true if object sharing is allowed.
     bool getSharing() const {return sharing_;}
     
+    /** Reuses existing objects when reading.
+     * If _mode_ is true, read() overwrites the elements of the containers
+     * (vectors, deques, lists, forward_lists and maps) that are already in the object
+     * being read instead of clearing these containers and re-creating their elements.
+     * Only missing elements are created and only extra elements are destroyed,
+     * and the capacity of vectors and strings is kept. This makes reloading an object
+     * whose content has not changed much very cheap.
+     *
+     * Objects are assumed to contain all their members (as written by write()),
+     * members that are not in the JSON data keep their previous values.
+     * The pointees of non-null pointers are also reused if they have the class
+     * given by the JSON data (and if they are not pointed by several pointers that
+     * point to distinct objects in the JSON data), otherwise they are re-created as
+     * usual. Sets are cleared as usual.
+     */
+    void setReuse(bool mode = true) {reuse_ = mode;}
+    
+    /// Return true if existing objects are reused when reading.
+    bool getReuse() const {return reuse_;}
+    
+    /** Trusts the files that were written with the same classes.
+     * If _mode_ is true, write() writes a fingerprint of the classes (see
+     * JsonClasses::fingerprint()) as a comment on the first line of the files.
+     * read() then compares this fingerprint with the fingerprint of its classes:
+     * if they are the same, the file is assumed to have been written by JsonSerial
+     * and is read faster, without checking for control characters nor for unquoted
+     * strings, and without allowing comments. Otherwise, the file is read as usual.
+     *
+     * This option should only be used for files that are not modified by hand.
+     * validate() never trusts files.
+     *
+     * Because of the comment, the files are no longer strict JSON: they can only be read
+     * by JsonSerials that have this option on, or that allow comments (the default,
+     * see setSyntax()), and by other parsers that accept comments. Only this exact
+     * header is skipped: other comments are handled as specified by setSyntax().
+     * The header is only recognized if the stream buffers it (this is the case of
+     * files and string streams), otherwise the file is read as usual.
+     */
+    void setFingerprint(bool mode = true) {fingerprint_ = mode;}
+    
+    /// Return true if the files written with the same classes are trusted.
+    bool getFingerprint() const {return fingerprint_;}
+    
+    /** Reads files in advance in another thread.
+     * If _blocksize_ is not 0, read(), patch() and validate() read files by blocks of
+     * _blocksize_ bytes in another thread while the data that has already been read
+     * is being parsed (see JsonReadAheadBuffer). This is useful for large files on slow
+     * (e.g. network) file systems.
+     */
+    void setReadAhead(size_t blocksize = 1024*1024) {readahead_ = blocksize;}
+    
+    /// Returns the block size used for reading files in advance (0 if none).
+    size_t getReadAhead() const {return readahead_;}
+    
+    /** Writes files in another thread.
+     * If _blocksize_ is not 0, write() formats data in blocks of _blocksize_ bytes
+     * that are written to the file (and finally synced to disk) by another thread
+     * (see JsonWriteBehindBuffer). This is useful for large files.
+     */
+    void setWriteBehind(size_t blocksize = 1024*1024) {writebehind_ = blocksize;}
+    
+    /// Returns the block size used for writing files in another thread (0 if none).
+    size_t getWriteBehind() const {return writebehind_;}
+    
     /* JSON syntax.
      * - Strict: strict JSON syntax
      * - Relaxed: all options are allowed
@@ -274,6 +553,53 @@ namespace jsonserial {
 
     /// Returns current indentation.
     void getIndent(char& tabchar, unsigned int& tabcount) const {tabchar = tabchar_; tabcount = indent_;}
+    
+    /** Stores the strings that are read as char*, const char*, std::string_view
+     *  or InternedString in _buffer_.
+     *  By default, char* and const char* strings are allocated by strdup() and
+     *  std::string_view and InternedString variables cannot be read.
+     *  If a JsonStringBuffer is specified, these strings are stored in this buffer
+     *  (which avoids many small allocations) and they must NOT be freed: they remain
+     *  valid as long as the buffer exists. Identical strings are stored once if the
+     *  buffer was created with interning on.
+     *  This is useful for reading large read-only data. _buffer_ can be null.
+     */
+    void setStringBuffer(std::shared_ptr<JsonStringBuffer> buffer) {strings_ = buffer;}
+    
+    /// Returns the string buffer (null if none).
+    std::shared_ptr<JsonStringBuffer> getStringBuffer() const {return strings_;}
+    
+    /** Collects errors in a log instead of reporting them.
+     *  If _log_ is not null, errors and warnings are added to _log_ (which bounds
+     *  and deduplicates them) instead of being printed or passed to the error handler.
+     *  They are not formatted until the log is printed. read() and write() still
+     *  return false in case of an error, and getError() still returns the last error.
+     *  This is useful for reading noisy data that produces many warnings.
+     */
+    void setErrorLog(std::shared_ptr<JsonErrorLog> log) {errorlog_ = log;}
+    
+    /// Returns the error log (null if none).
+    std::shared_ptr<JsonErrorLog> getErrorLog() const {return errorlog_;}
+    
+    /** Creates the objects that are read in _arena_.
+     *  By default, each object created by read() (the pointees of raw and smart pointers
+     *  and char* strings) is allocated separately. If an arena is specified, these
+     *  objects are allocated in the arena and they are all destroyed at once when the
+     *  arena is destroyed: they must NOT be deleted (nor char* strings freed).
+     *  The arena must outlive these objects, including those pointed by shared_ptrs
+     *  (which do not keep the arena alive, otherwise objects containing shared_ptrs
+     *  would create cycles). Objects pointed by unique_ptrs are not created in the
+     *  arena (they are deleted by the unique_ptr).
+     *  Objects created by custom creator functions are deleted with the arena, except
+     *  if their class is only known as an abstract class without a virtual destructor
+     *  (i.e. there is no "@class" field): they can't be deleted safely and are thus
+     *  never deleted (they must be deleted by the program if needed).
+     *  This is useful for reading large read-only data. _arena_ can be null.
+     */
+    void setArena(std::shared_ptr<JsonArena> arena) {arena_ = arena;}
+    
+    /// Returns the arena (null if none).
+    std::shared_ptr<JsonArena> getArena() const {return arena_;}
 
     template <class T>
     void readMember(T& variable, const std::string& str) {
@@ -288,7 +614,20 @@ namespace jsonserial {
     
     // - - - Read - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     
-    // throws if class not found.
+    // copies a string that is read as a char* or a const char*.
+    char* copyString(const std::string& s) {
+      return strings_ ? strings_->store(s) : arena_ ? arena_->copyString(s) : ::strdup(s.c_str());
+    }
+    
+    // creates a pointee that is not a defobject.
+    template <class T> T* createValue() {return arena_ ? arena_->create<T>() : new T{};}
+    
+    // makes a shared_ptr point to a pointee that was created by read().
+    template <class T> void resetShared(std::shared_ptr<T>& ptr, T* p) {
+      if (arena_) ptr.reset(p, JsonArenaRef{arena_.get()}); else ptr.reset(p);
+    }
+    
+    // produces an error if class not found.
     const MetaClass* getCheckedClass(const std::type_info& tinfo) {
       const MetaClass* cl = classes_.getClass(tinfo);
       if (!cl) error(JsonError::UnknownClass, tinfo.name());
@@ -306,6 +645,16 @@ namespace jsonserial {
     // writes a C++ string.
     void writeValue(const std::string& s) {writeString(s.c_str(), false);}
     
+#if __cplusplus >= 201703L
+    // writes a string view.
+    void writeValue(std::string_view s) {
+      out_->put('"');
+      for (char c : s) {if (const char* esc = escapeChar(c)) out_->write(esc, 2); else out_->put(c);}
+      out_->put('"');
+      needcomma_ = true;
+    }
+#endif
+    
     // writes a C string.
     void writeValue(char* s) {writeString(s, true);}
     void writeValue(const char* s) {writeString(s, true);}
@@ -316,13 +665,29 @@ namespace jsonserial {
     // writes a raw pointer (note: is_pointer differentiates from is_array).
     template <class T>
     void writeValue2(const typename std::enable_if<std::is_pointer<T>::value,T>::type & ptr) {
-      if (!ptr) *out_ << "null"; else writeValue(*ptr);
+      if (!ptr) *out_ << "null"; else writePointee(*ptr);
     }
     
     // writes a smart pointer.
     template <class T>
     void writeValue2(const typename std::enable_if<is_smart_ptr<T>::value,T>::type & ptr) {
-      if (!ptr) *out_ << "null"; else writeValue(*ptr);
+      if (!ptr) *out_ << "null"; else writePointee(*ptr);
+    }
+    
+    // writes a non-object pointee.
+    template <class E>
+    typename std::enable_if<!is_defobject<E>::value>::type writePointee(const E& obj) {
+      writeValue(obj);
+    }
+    
+    // writes an object pointee, or a reference to this object when writing a delta.
+    template <class E>
+    typename std::enable_if<is_defobject<E>::value>::type writePointee(const E& obj) {
+      if (!delta_) {writeValue(obj); return;}
+      const MetaClass* cl = getCheckedClass(typeid(obj));
+      if (failed()) return;
+      *out_ << "\"@" << delta_->objectID(&obj, *cl, true) << '"';
+      needcomma_ = true;
     }
     
     // writes a number.
@@ -340,14 +705,14 @@ namespace jsonserial {
     // writes a map.
     template <class T>
     void writeValue2(const typename std::enable_if<is_std_map<T>::value,T>::type & obj) {
-      MapClass<T> cl; writeObject(cl, false, &obj);
+      MapClass<T> cl; writeObject(cl, false, &obj, true);
     }
     
     // writes a defobject.
     template <class T>
     void writeValue2(const typename std::enable_if<is_defobject<T>::value,T>::type & obj) {
       const MetaClass* cl = classes_.getClass(typeid(obj));
-      if (!cl) error(JsonError::UnknownClass, typeid(obj).name());
+      if (!cl) {error(JsonError::UnknownClass, typeid(obj).name()); return;}
       writeObject(*cl, (typeid(obj) != typeid(T)), &obj);
     }
     
@@ -363,12 +728,22 @@ namespace jsonserial {
       if (std::extent<T>::value == 0) *out_ << "[]"; else writeArray(carray);
     }
     
+    // writes an object that has its own JSON format.
+    template <class T>
+    void writeValue2(const typename std::enable_if<has_custom_format<T>::value,T>::type & obj) {
+      obj.writeJson(*this);
+    }
+    
     // writes a defobject.
-    void writeObject(const MetaClass& cl, bool is_derived_class, const void* obj) {
-      if (sharing_) {
+    void writeObject(const MetaClass& cl, bool is_derived_class, const void* obj, bool is_map = false) {
+      unsigned long id = 0;
+      if (delta_) {   // maps have no persistent ID
+        if (!is_map) id = delta_->objectID(obj, cl, false);
+      }
+      else if (sharing_) {
         auto it = object_to_id_.find(obj);
         if (it != object_to_id_.end()) {*out_ << "\"@"<< it->second <<'"'; return;}
-        else object_to_id_[obj] = ++current_object_id_;
+        else object_to_id_[obj] = id = ++current_object_id_;
       }
       needcomma_ = false;
       *out_ << "{\n";
@@ -376,8 +751,8 @@ namespace jsonserial {
       if (is_derived_class) {   // polymorphism
         writeTabs(); *out_ << "\"@class\": \"" << cl.classname() << "\",\n";
       }
-      if (sharing_) {
-        writeTabs(); *out_ << "\"@id\": \"" << current_object_id_ << "\",\n";
+      if (id) {
+        writeTabs(); *out_ << "\"@id\": \"" << id << "\",\n";
       }
       cl.writeMembers(*this, obj);
       removeTab();
@@ -407,42 +782,237 @@ namespace jsonserial {
       else {
         out_->put('"');
         for (; *s != 0; ++s) {
-          switch (*s) {
-            case '"': out_->put('\\'); out_->put('"'); break;
-            case '\\': out_->put('\\'); out_->put('\\'); break;
-            case '\b': out_->put('\\'); out_->put('b'); break;
-            case '\f': out_->put('\\'); out_->put('f'); break;
-            case '\n': out_->put('\\'); out_->put('n'); break;
-            case '\r': out_->put('\\'); out_->put('r'); break;
-            case '\t': out_->put('\\'); out_->put('t'); break;
-            default: out_->put(*s);
-          }
+          if (const char* esc = escapeChar(*s)) out_->write(esc, 2); else out_->put(*s);
         }
         out_->put('"');
       }
       needcomma_ = true;
     }
     
-    /// produces an error; throws except if _warning_ is true.
+    // writes raw JSON text (as obtained by readRaw()).
+    void writeRaw(const std::string& raw) {
+      if (raw.empty()) *out_ << "null"; else *out_ << raw;
+      needcomma_ = true;
+    }
+    
+    // returns the escape sequence of c, null if c does not need to be escaped.
+    static const char* escapeChar(char c) {
+      switch (c) {
+        case '"': return "\\\"";
+        case '\\': return "\\\\";
+        case '\b': return "\\b";
+        case '\f': return "\\f";
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        default: return nullptr;
+      }
+    }
+    
+    /** produces an error; throws except if _fatal_ is false.
+     * If JSONSERIAL_NO_EXCEPTIONS is defined, fatal errors do not throw: failed() then
+     * returns true and the functions that read or write JSON data return as soon as
+     * possible. Errors that occur after a fatal error are ignored.
+     */
     void error(JsonError::Type type, const std::string& arg = "", bool fatal = true) {
-      std::string where = (in_!=nullptr || type==JsonError::CantReadFile) ? "read" : "write";
-      if (!jsonerror_) jsonerror_ = new JsonError();
-      jsonerror_->set(type, fatal, where, arg, streamname_, lineno_, errhandler_);
+      static const std::string none;
+      error(type, arg, none, none, fatal);
+    }
+    
+    /// produces an error that concerns a member of a class (see error()).
+    void memberError(JsonError::Type type, const std::string& classname,
+                     const std::string& member, bool fatal = true) {
+      if (errorlog_) error(type, "", classname, member, fatal);
+      else error(type, "'" + member + "' in class '" + classname + "'", fatal);
+    }
+    
+    void error(JsonError::Type type, const std::string& arg,
+               const std::string& classname, const std::string& member, bool fatal) {
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+      if (failed_) return;
+#endif
+      if (!jsonerror_) {
+        jsonerror_ = spareerror_ ? spareerror_ : new JsonError();
+        spareerror_ = nullptr;
+      }
+      JsonError& e = *jsonerror_;
+      e.type = type;
+      e.fatal = fatal;
+      e.where = (in_!=nullptr || type==JsonError::CantReadFile) ? "read" : "write";
+      e.arg = arg;
+      e.classname = classname;
+      e.member = member;
+      e.streamname = streamname_;
+      locate(e);
+      if (errorlog_) errorlog_->add(e);
+      else if (errhandler_) errhandler_(e);
+      else e.print(std::cerr);
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+      failed_ = fatal;
+#else
       if (fatal) throw jsonerror_;
+#endif
     }
     
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+    /// returns true if a fatal error occurred (see error()).
+    bool failed() const {return failed_;}
+#else
+    /// returns true if a fatal error occurred: always false as fatal errors throw.
+    static constexpr bool failed() {return false;}
+#endif
+    
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     
   //private:
     template <class T> friend class ObjectClass;
     template <class T> friend class MapClass;
     
+    // copies the options that can be used by several threads.
+    void copySettings(const JsonSerial& js) {
+      allow_ = js.allow_;
+      sharing_ = js.sharing_;
+      reuse_ = js.reuse_;
+      fingerprint_ = js.fingerprint_;
+      tabchar_ = js.tabchar_;
+      indent_ = js.indent_;
+      readahead_ = js.readahead_;
+      writebehind_ = js.writebehind_;
+    }
+    
+    template <class Fun>
+    static void forEachFile(size_t count, JsonThreadPool* pool, Fun fun) {
+      if (count == 0) return;
+      else if (pool) pool->run(count, fun);
+      else {
+        JsonThreadPool tmp(std::min(size_t(std::max(1u, std::thread::hardware_concurrency())), count));
+        tmp.run(count, fun);
+      }
+    }
+    
+    // file read by read(), patch() and validate().
+    class InputFile : public std::istream {
+    public:
+      InputFile(const std::string& filename, size_t readahead) : std::istream(nullptr) {
+        if (readahead) {
+          ahead_.reset(new JsonReadAheadBuffer(filename, readahead));
+          if (ahead_->isOpen()) rdbuf(ahead_.get());
+        }
+        else if (file_.open(filename, std::ios::in)) rdbuf(&file_);
+      }
+    private:
+      std::filebuf file_;
+      std::unique_ptr<JsonReadAheadBuffer> ahead_;
+    };
+    
+    // file written by write().
+    class OutputFile : public std::ostream {
+    public:
+      OutputFile(const std::string& filename, size_t writebehind) : std::ostream(nullptr) {
+        if (writebehind) {
+          behind_.reset(new JsonWriteBehindBuffer(filename, writebehind));
+          if (behind_->isOpen()) rdbuf(behind_.get());
+        }
+        else if (file_.open(filename, std::ios::out)) rdbuf(&file_);
+      }
+      // returns false if all data could not be written.
+      bool close() {
+        bool ok = bool(flush());
+        if (behind_) return behind_->close() && ok;
+        return file_.close() && ok;
+      }
+    private:
+      std::filebuf file_;
+      std::unique_ptr<JsonWriteBehindBuffer> behind_;
+    };
+    
+    // gives persistent IDs to the objects that are written (see JsonDelta).
+    struct IdTracker {
+      virtual ~IdTracker() {}
+      // returns the ID of _obj_, _pointee_ is true if _obj_ is pointed (not embedded).
+      virtual unsigned long objectID(const void* obj, const MetaClass& cl, bool pointee) = 0;
+    };
+    
+    /* type of the tokens returned by readLine(). Unquoted tokens are classified by
+     * checkValue(), which also computes the value of integers, so that they are
+     * not scanned again when they are converted.
+     */
+    enum TokenType {
+      NoToken, StringToken, IntegerToken, FloatToken, TrueToken, FalseToken, NullToken,
+      ObjectToken, ArrayToken, OtherToken
+    };
+    
+    /* forgets the value returned by readLine() when the strings it was read in are
+     * destroyed: declared after these strings, so that tokenType() never compares _s_
+     * with a dangling pointer.
+     */
+    struct TokenScope {
+      JsonSerial& js_;
+      ~TokenScope() {js_.token_ = nullptr;}
+    };
+    
+    // type of _s_ if it is the value returned by the last readLine(), otherwise computed from its text.
+    TokenType tokenType(const std::string& s) const {
+      return &s == token_ ? tokentype_ : scanToken(s);
+    }
+    
+    // true if _s_ is the value returned by the last readLine() and an integer that fits in _value_.
+    bool integerToken(const std::string& s, unsigned long long& value, bool& negative) const {
+      if (&s != token_ || tokentype_ != IntegerToken || tokenbig_) return false;
+      value = tokenint_;
+      negative = s[0] == '-';
+      return true;
+    }
+    
+    // internal syntax option for trusted files (see setFingerprint()).
+    enum {Trusted = 0x40};
+    
+    static std::string hexString(uint64_t n) {
+      std::string s(16, '0');
+      for (int k = 15; k >= 0; --k, n >>= 4) s[k] = "0123456789abcdef"[n & 15];
+      return s;
+    }
+    
+    /* reads the fingerprint written by write(). The first line is only consumed if it
+     * is the header of these classes: it is found in the buffer of the stream without
+     * reading it, so that other lines are left to the syntax check (e.g. comments
+     * are errors with the Strict syntax). Returns false otherwise.
+     */
+    bool readFingerprint() {
+      if (in_->peek() != '/' || !in_->rdbuf()) return false;   // peek() fills the buffer
+      const std::string header = "// jsonserial " + hexString(classes_.fingerprint()) + "\n";
+      std::streambuf* buf = in_->rdbuf();
+      const char* p = BufferAccess::current(buf);
+      if (!p || size_t(BufferAccess::end(buf) - p) < header.size()
+          || header.compare(0, header.size(), p, header.size()) != 0) return false;
+      in_->ignore(std::streamsize(header.size()));
+      consumed_ += header.size();
+      return true;
+    }
+    
+    // is this syntax option allowed? (see readLine2()).
+    template <int Allow> bool allows(int option) const {
+      return Allow >= 0 ? (Allow & option) != 0 : (allow_ & option) != 0;
+    }
+    
+    // reads the next token (or name:value pair if _inObj_ is true) with the current syntax.
     void readLine(std::string& token1, std::string& token2, bool& found1, bool& found2, bool inObj) {
+      (this->*readline_)(token1, token2, found1, found2, inObj);
+    }
+    
+    /* tokenizer for syntax _Allow_ (an ORred mask of Syntax values and Trusted), or for the
+     * current syntax if _Allow_ is -1. The tests on the syntax are evaluated at
+     * compile time in the first case: the Strict tokenizer has no comment branches.
+     */
+    template <int Allow>
+    void readLine2(std::string& token1, std::string& token2, bool& found1, bool& found2, bool inObj) {
       token1.clear();
       token2.clear();
       token1_.clear();
       token2_.clear();
       found1 = found2 = false;
+      token_ = inObj ? &token2 : &token1;
+      tokentype_ = NoToken;
       enum {
         Begin, InQuotedToken1, InUnquotedToken1, AfterToken1, AfterComa,
         InQuotedToken2, InUnquotedToken2, AfterToken2, Comment, LineComment
@@ -451,60 +1021,66 @@ namespace jsonserial {
       char c = 0;
       
       while (true) {
-        if (!in_->get(c)) {
-          if (!token1_.empty()) {token1 = token1_; checkValue(token1,inObj);}
+        if (!getChar(c)) {
+          if (token1.empty() && !token1_.empty()) {token1 = token1_; checkValue<Allow>(token1,inObj);}
           return;
         }
         
-        if (c == '\n')
-          lineno_++;
-        else if (::iscntrl(c) && !::isspace(c))
+        if (!allows<Allow>(Trusted) && ::iscntrl(c) && !::isspace(c))
           goto INVALID_CHAR;
-        else if ((allow_&Comments) && part!=InQuotedToken1 && part!=InQuotedToken2) {
+        else if (allows<Allow>(Comments) && part!=InQuotedToken1 && part!=InQuotedToken2) {
           if (part != Comment && c == '/' && in_->peek() == '/') {
             if (part != LineComment) {lastPart = part; part = LineComment;}
           }
           else if (part != LineComment && c == '/' && in_->peek() == '*') {
-            if (part != Comment) {in_->get(c); lastPart = part; part = Comment;}
+            if (part != Comment) {getChar(c); lastPart = part; part = Comment;}
           }
         }
         switch (part) {
           case Begin:
-            if (c == '"') {found1 = true; part = InQuotedToken1;}
-            else if (c == '{' || c == '[') {found1 = true; token1 = c; return;}
+            if (c == '"') {found1 = true; tokentype_ = StringToken; part = InQuotedToken1;}
+            else if (c == '{' || c == '[') {
+              found1 = true; token1 = c; tokentype_ = c == '{' ? ObjectToken : ArrayToken; return;
+            }
             else if (!::isspace(c)) {found1 = true; token1_ += c; part = InUnquotedToken1;}
             break;
           case InQuotedToken1:
             if (c == '"') {token1 = token1_; part = AfterToken1;}
             else if (c == '\\') readEscape(token1_);
-            else if (::iscntrl(c) && (!(allow_&Newlines) || !::isspace(c))) goto INVALID_CHAR;
+            else if (!allows<Allow>(Trusted) && ::iscntrl(c) && (!allows<Allow>(Newlines) || !::isspace(c)))
+              goto INVALID_CHAR;
             else token1_ += c;
             break;
           case InUnquotedToken1:
-            if (c == ',' || ((allow_&NoCommas) && c == '\n')) {token1 = token1_; checkValue(token1,inObj); return;}
+            if (c == ',' || (allows<Allow>(NoCommas) && c == '\n')) {token1 = token1_; checkValue<Allow>(token1,inObj); return;}
             else if (c == '}' || c == ']')
-             {in_->putback(c); token1 = token1_; checkValue(token1,inObj); return;}
-            else if (c == ':' && inObj) {token1 = token1_; checkValue(token1,inObj); part = AfterComa;}
+             {ungetChar(c); token1 = token1_; checkValue<Allow>(token1,inObj); return;}
+            else if (c == ':' && inObj) {
+              token1 = token1_; checkValue<Allow>(token1,inObj); part = AfterComa;
+              if (failed()) return;
+            }
             else if (c == '\\') readEscape(token1_);
             else token1_ += c;
             break;
           case AfterToken1:
-            if (c == ',' || ((allow_&NoCommas) && c == '\n')) return;
-            else if (c == '}' || c == ']') {in_->putback(c); return;}
+            if (c == ',' || (allows<Allow>(NoCommas) && c == '\n')) return;
+            else if (c == '}' || c == ']') {ungetChar(c); return;}
             else if (c == ':' && inObj) part = AfterComa;
             else if (!::isspace(c)) {error(JsonError::ExpectingComma); return;}
             break;
           case AfterComa:
             if (c == '"') {
-              found2 = true;
+              found2 = true; tokentype_ = StringToken;
               if (in_->peek() != '"') part = InQuotedToken2;
               else {
-                in_->get(c);
+                getChar(c);
                 if (in_->peek() != '"') {token2 = ""; part = AfterToken2;}
-                else {in_->get(c); part = InQuotedToken2; in_multiquotes_ = true;}
+                else {getChar(c); part = InQuotedToken2; in_multiquotes_ = true;}
               }
             }
-            else if (c == '{' || c == '[') {found2 = true; token2 = c; return;}
+            else if (c == '{' || c == '[') {
+              found2 = true; token2 = c; tokentype_ = c == '{' ? ObjectToken : ArrayToken; return;
+            }
             else if (!::isspace(c)) {found2 = true; token2_ += c; part = InUnquotedToken2;}
             break;
           case InQuotedToken2:
@@ -512,34 +1088,35 @@ namespace jsonserial {
               if (!in_multiquotes_) {token2 = token2_; part = AfterToken2;}
               else if (in_->peek() != '"') token2_ += '"';
               else {
-                in_->get(c);
+                getChar(c);
                 if (in_->peek() != '"') token2_ += "\"\"";
                 else {
-                  in_->get(c); token2 = token2_; part = AfterToken2; in_multiquotes_ = false;
+                  getChar(c); token2 = token2_; part = AfterToken2; in_multiquotes_ = false;
                 }
               }
             }
             else if (in_multiquotes_ && ::isspace(c)) token2_ += c;
             else if (c == '\\') readEscape(token2_);
-            else if (::iscntrl(c) && (!(allow_&Newlines) || !::isspace(c))) goto INVALID_CHAR;
+            else if (!allows<Allow>(Trusted) && ::iscntrl(c) && (!allows<Allow>(Newlines) || !::isspace(c)))
+              goto INVALID_CHAR;
             else token2_ += c;
             break;
           case InUnquotedToken2:
-            if (c == ',' || ((allow_&NoCommas) && c == '\n')) {token2 = token2_; checkValue(token2,false); return;}
-            else if (c == '}' || c == ']') {in_->putback(c); token2 = token2_; checkValue(token2,false); return;}
+            if (c == ',' || (allows<Allow>(NoCommas) && c == '\n')) {token2 = token2_; checkValue<Allow>(token2,false); return;}
+            else if (c == '}' || c == ']') {ungetChar(c); token2 = token2_; checkValue<Allow>(token2,false); return;}
             else if (c == '\\') readEscape(token2_);
             else token2_ += c;
             break;
           case AfterToken2:
-            if (c == ',' || ((allow_&NoCommas) && c == '\n')) return;
-            else if (c == '}' || c == ']') {in_->putback(c); return;}
+            if (c == ',' || (allows<Allow>(NoCommas) && c == '\n')) return;
+            else if (c == '}' || c == ']') {ungetChar(c); return;}
             else if (!::isspace(c)) {error(JsonError::ExpectingDelimiter); return;}
             break;
           case LineComment:
-            if ((allow_&Comments) && c == '\n') part = lastPart;
+            if (allows<Allow>(Comments) && c == '\n') part = lastPart;
             break;
           case Comment:
-            if ((allow_&Comments) && (c == '*' && in_->peek() == '/')) {in_->get(c); part = lastPart;}
+            if (allows<Allow>(Comments) && (c == '*' && in_->peek() == '/')) {getChar(c); part = lastPart;}
             break;
         }
       }
@@ -551,7 +1128,8 @@ namespace jsonserial {
     }
     
     void readEscape(std::string& token) {
-      int c = in_->get();
+      char ch = 0;
+      int c = getChar(ch) ? ch : EOF;
       switch (c) {
         case '"': token += '"'; break;
         case '\\': token += '\\'; break;
@@ -566,23 +1144,108 @@ namespace jsonserial {
       }
     }
     
-    bool isNumber(const std::string& token) {
-      if (token.empty()) return false;
-      bool dotfound{false}, expfound{false};
+    /* reads the raw JSON text of a value, without tokenizing it.
+     * s is the first token of the value as returned by readLine(): the value is read
+     * until the closing brace or bracket if s is { or [. The text is appended to _raw_
+     * (comments excepted) if _raw_ is not null.
+     */
+    void readRaw(std::string* raw, const std::string& s) {
+      if (s != "{" && s != "[") {   // a scalar value, already read by readLine()
+        if (!raw) return;
+        if (tokenType(s) != StringToken) {*raw += s; return;}
+        *raw += '"';
+        for (char c : s) {if (const char* esc = escapeChar(c)) *raw += esc; else *raw += c;}
+        *raw += '"';
+        return;
+      }
+      if (raw) *raw += s;
+      int depth{1};
+      bool instring{false};
+      char c = 0;
+      while (depth > 0 && getChar(c)) {
+        if (instring) {
+          if (c == '"') instring = false;
+          else if (c == '\\') {
+            if (raw) *raw += c;
+            if (!getChar(c)) break;
+          }
+        }
+        else if (c == '"') instring = true;
+        else if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') depth--;
+        else if (skipComment(c)) continue;
+        if (raw) *raw += c;
+      }
+      if (depth > 0) {error(JsonError::PrematureEOF); return;}
+      readDelimiter();
+    }
+    
+    // reads the delimiter that follows a value read by readRaw().
+    void readDelimiter() {
+      char c = 0;
+      while (getChar(c)) {
+        if (c == ',' || ((allow_&NoCommas) && c == '\n')) return;
+        else if (c == '}' || c == ']') {ungetChar(c); return;}
+        else if (!skipComment(c) && !::isspace(c)) {error(JsonError::ExpectingDelimiter); return;}
+      }
+    }
+    
+    // skips a comment if c starts a comment and comments are allowed.
+    bool skipComment(char c) {
+      if (!(allow_&Comments) || c != '/') return false;
+      if (in_->peek() == '/') {     // the final newline is not skipped
+        while (in_->peek() != '\n' && getChar(c)) {}
+        return true;
+      }
+      else if (in_->peek() == '*') {
+        getChar(c);
+        while (getChar(c)) {
+          if (c == '*' && in_->peek() == '/') {getChar(c); break;}
+        }
+        return true;
+      }
+      return false;
+    }
+    
+    /* classifies an unquoted token. The value of integers is computed in the same pass,
+     * _overflow_ is set if it doesn't fit in _value_. Numbers are checked loosely:
+     * strtod() detects the other errors when they are converted.
+     */
+    static TokenType scanToken(const std::string& token) {
+      unsigned long long value{0};
+      bool overflow{false};
+      return scanToken(token, value, overflow);
+    }
+    
+    static TokenType scanToken(const std::string& token, unsigned long long& value, bool& overflow) {
       const char *p = token.c_str();
+      switch (*p) {
+        case 0: return NoToken;
+        case 't': return token == "true" ? TrueToken : OtherToken;
+        case 'f': return token == "false" ? FalseToken : OtherToken;
+        case 'n': return token == "null" ? NullToken : OtherToken;
+      }
+      bool dotfound{false}, expfound{false};
+      const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+      value = 0;
+      overflow = false;
       if (*p == '-') ++p;
-      for (; *p != 0; ++p)
-        if (!::isdigit(*p)) {
-          if (*p=='.') {if (dotfound) return false; else dotfound = true;}
-          else if (*p=='e' || *p=='E') {
-            if (expfound) return false; else expfound = true;
-            if (*(p+1)=='+' || *(p+1)=='-') ++p;
-          }
-          else return false;
+      for (; *p != 0; ++p) {
+        if (::isdigit(*p)) {
+          unsigned d = *p - '0';
+          if (value > (max - d) / 10) overflow = true; else value = value * 10 + d;
         }
-      return true;
+        else if (*p=='.') {if (dotfound) return OtherToken; else dotfound = true;}
+        else if (*p=='e' || *p=='E') {
+          if (expfound) return OtherToken; else expfound = true;
+          if (*(p+1)=='+' || *(p+1)=='-') ++p;
+        }
+        else return OtherToken;
+      }
+      return (dotfound || expfound || !::isdigit(p[-1])) ? FloatToken : IntegerToken;
     }
     
+    template <int Allow>
     void checkValue(std::string& token, bool objName) {
       if (!token.empty()) {   // trimRight
         const char *s = token.c_str(), *end = s + token.length()-1;
@@ -590,35 +1253,136 @@ namespace jsonserial {
         if (end >= s) token.assign(s, end-s+1);
       }
       if (objName) {
-        if ((allow_&NoQuotes) || token[0]=='}' || token[0]==']') return;
+        if (allows<Allow>(NoQuotes|Trusted) || token[0]=='}' || token[0]==']') return;
         else error(JsonError::ExpectingString, token);
       }
-      else if ((allow_&NoQuotes) || token.empty()
-          || token[0]=='}' || token[0]==']' || token=="true" || token=="false" || token=="null"
-          || isNumber(token))
-        return;
-      else error(JsonError::InvalidValue, token+" (should be quoted?)");
+      else {
+        tokentype_ = scanToken(token, tokenint_, tokenbig_);
+        if (tokentype_ == OtherToken && !allows<Allow>(NoQuotes|Trusted) && token[0]!='}' && token[0]!=']')
+          error(JsonError::InvalidValue, token+" (should be quoted?)");
+      }
     }
     
+    // called before each read or write: buffers, tables and the error are kept
+    // so that reusing the same JsonSerial for many small messages doesn't allocate memory.
     void reset(const std::string& streamname, size_t lineno, std::istream *in, std::ostream *out) {
       in_ = in;
       out_ = out;
-      if (in_) in_->imbue(locale_);
-      if (out_) out_->imbue(locale_);
+      if (in_ && in_->getloc() != locale_) in_->imbue(locale_);
+      if (out_ && out_->getloc() != locale_) out_->imbue(locale_);
       streamname_ = streamname;
       lineno_ = lineno;
+      consumed_ = located_ = 0;
+      locline_ = lineno;
+      loccol_ = 1;
       needcomma_ = false;
       level_ = 0;
       token1_.reserve(50);
       token2_.reserve(50);
       in_multiquotes_ = false;
-      tabs_.assign(40, tabchar_);
-      object_to_id_.clear();
-      id_to_object_.clear();
+      token_ = nullptr;
+      if (allow_ == Strict) readline_ = &JsonSerial::readLine2<Strict>;
+      else if (allow_ == Comments) readline_ = &JsonSerial::readLine2<Comments>;
+      else readline_ = &JsonSerial::readLine2<-1>;
+      if (tabs_.size() < 40 || tabs_[0] != tabchar_) tabs_.assign(40, tabchar_);
+      if (!object_to_id_.empty()) object_to_id_.clear();  // clear() is O(bucket count)
+      if (!id_to_object_.empty()) id_to_object_.clear();
+      if (!reused_.empty()) reused_.clear();
       current_object_id_ = 0;
-      delete jsonerror_; jsonerror_ = nullptr;
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+      failed_ = false;
+#endif
+      if (jsonerror_) {   // kept for the next error
+        delete spareerror_;
+        spareerror_ = jsonerror_;
+        jsonerror_ = nullptr;
+      }
+    }
+    
+    // reads a character, counts characters for error messages (see locate()).
+    bool getChar(char& c) {
+      if (!in_->get(c)) return false;
+      ++consumed_;
+      return true;
+    }
+    
+    // puts back a character read by getChar().
+    void ungetChar(char c) {in_->putback(c); --consumed_;}
+    
+    // gives access to the get area of a streambuf (see locate()).
+    struct BufferAccess : std::streambuf {
+      static const char* begin(std::streambuf* b) {return (b->*&BufferAccess::eback)();}
+      static const char* current(std::streambuf* b) {return (b->*&BufferAccess::gptr)();}
+      static const char* end(std::streambuf* b) {return (b->*&BufferAccess::egptr)();}
+    };
+    
+    // counts the lines and the columns of n characters (see locate()).
+    void countLines(const char* p, size_t n) {
+      for (const char* end = p + n; p < end; ++p) {
+        if (*p == '\n') {++locline_; loccol_ = 1;} else ++loccol_;
+      }
     }
     
+    /* computes the line and the column of the current position when reading.
+     * Lines are not counted while reading: the characters that were read since the
+     * previously located position are read again, from the buffer of the stream if
+     * they are still there, otherwise by repositioning the stream (which is then
+     * restored). Returns false (line unknown) if neither is possible.
+     */
+    bool locate(size_t& line, size_t& column) {
+      if (lineno_ == 0 || !in_ || !in_->rdbuf()) return false;
+      if (located_ > consumed_) {located_ = 0; locline_ = lineno_; loccol_ = 1;}
+      std::streambuf* buf = in_->rdbuf();
+      size_t n = consumed_ - located_;
+      const char* cur = BufferAccess::current(buf);
+      if (cur && size_t(cur - BufferAccess::begin(buf)) >= n) countLines(cur - n, n);
+      else {
+        std::streamoff pos = buf->pubseekoff(0, std::ios::cur, std::ios::in);
+        if (pos < std::streamoff(n) || buf->pubseekpos(pos - n, std::ios::in) != pos - std::streamoff(n))
+          return false;
+        size_t count = 0;
+        char chunk[4096];
+        while (count < n) {
+          std::streamsize k = buf->sgetn(chunk, std::streamsize(std::min(sizeof(chunk), n - count)));
+          if (k <= 0) break;
+          countLines(chunk, size_t(k));
+          count += size_t(k);
+        }
+        buf->pubseekpos(pos, std::ios::in);
+        if (count < n) {located_ = 0; locline_ = lineno_; loccol_ = 1; return false;}
+      }
+      located_ = consumed_;
+      line = locline_;
+      column = loccol_;
+      return true;
+    }
+    
+    /* sets the position of an error. When reading, the offset is the number of bytes
+     * read since the beginning of read(), the line and the column are 0 if unknown.
+     */
+    void locate(JsonError& e) {
+      if (in_) {
+        e.offset = consumed_;
+        if (!locate(e.line, e.column)) e.line = e.column = 0;
+      }
+      else {
+        std::streamoff pos = -1;
+        if (out_ && out_->rdbuf()) pos = out_->rdbuf()->pubseekoff(0, std::ios::cur, std::ios::out);
+        e.offset = pos < 0 ? 0 : size_t(pos);
+        e.line = lineno_;
+        e.column = 0;
+      }
+    }
+    
+    // returns the current line when reading (0 if unknown).
+    size_t currentLine() {
+      size_t line = 0, column = 0;
+      return locate(line, column) ? line : 0;
+    }
+    
+    // records the position of a member of the top-level object (see JsonDelta).
+    void markMember() {if (marks_ && level_ == 1) marks_->push_back(out_->tellp());}
+    
     void addTab() {if (++level_*indent_ >= tabs_.size()) tabs_.resize(tabs_.size() + 20, tabchar_);}
     void removeTab() {if (--level_ < 0) level_ = 0;}
     void writeTabs() {out_->write(tabs_.data(), level_*indent_);}
@@ -628,17 +1392,37 @@ namespace jsonserial {
     std::istream *in_{nullptr};
     std::ostream *out_{nullptr};
     unsigned char allow_{Comments};
+    void (JsonSerial::*readline_)(std::string&, std::string&, bool&, bool&, bool) {&JsonSerial::readLine2<-1>};
     bool needcomma_{false}, in_multiquotes_{false}, sharing_{false};
-    size_t lineno_{0};
+    bool reuse_{false}, patching_{false}, fingerprint_{false};
+    size_t readahead_{0}, writebehind_{0};
+    size_t lineno_{0};   // first line
+    size_t consumed_{0};   // bytes read (see locate())
+    size_t located_{0}, locline_{0}, loccol_{1};   // last located position (see locate())
     unsigned int indent_{2};
     int level_{0};
     char tabchar_{' '};
     std::string streamname_, tabs_, token1_, token2_;
+    const std::string* token_{nullptr};   // value returned by the last readLine()
+    TokenType tokentype_{NoToken};
+    unsigned long long tokenint_{0};   // value of the integer token
+    bool tokenbig_{false};   // the integer doesn't fit in tokenint_
     unsigned long current_object_id_{0};
     std::unordered_map<const void*, unsigned long> object_to_id_;
     std::unordered_map<unsigned long, ObjectPtr> id_to_object_;
+    std::shared_ptr<JsonStringBuffer> strings_;
+    std::shared_ptr<JsonArena> arena_;
+    std::shared_ptr<JsonErrorLog> errorlog_;
+    bool heap_next_{false};
+    std::unordered_set<const void*> reused_;   // pointees that were reused (see setReuse())
+    IdTracker* delta_{nullptr};
+    std::vector<std::streamoff>* marks_{nullptr};
     JsonError::Handler errhandler_{nullptr};
     JsonError* jsonerror_{nullptr};
+    JsonError* spareerror_{nullptr};
+#ifdef JSONSERIAL_NO_EXCEPTIONS
+    bool failed_{false};
+#endif
   };
 }
 
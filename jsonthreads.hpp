@@ -0,0 +1,128 @@
+//
+//  jsonthreads.hpp (included by jsonserial.hpp)
+//  Thread pool used for reading and writing many files or objects in parallel.
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonthreads_hpp
+#define jsonthreads_hpp
+
+namespace jsonserial {
+
+  /** Pool of threads that process independent tasks.
+   *  run() calls a function for each task, the tasks are taken one by one by the
+   *  threads of the pool (and by the calling thread) so that the load is balanced
+   *  even if the tasks have very different durations.
+   *  @see JsonSerial::readMany(), JsonSerial::writeMany().
+   */
+  class JsonThreadPool {
+  public:
+    /// Creates _threads_ threads, or one per core if _threads_ is 0.
+    explicit JsonThreadPool(size_t threads = 0) {
+      if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+      for (size_t k = 1; k < threads; ++k)   // the calling thread also works
+        workers_.emplace_back(&JsonThreadPool::work, this, k);
+    }
+
+    JsonThreadPool(const JsonThreadPool&) = delete;
+    JsonThreadPool& operator=(const JsonThreadPool&) = delete;
+
+    ~JsonThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cond_.notify_all();
+      for (auto& t : workers_) t.join();
+    }
+
+    /// Returns the number of threads (including the calling thread).
+    size_t size() const {return workers_.size() + 1;}
+
+    /** Returns the index of the current thread in [0, size()) while run() is executing.
+     *  Can serve to give each thread its own data.
+     */
+    static size_t workerIndex() {return currentIndex();}
+
+    /** Calls _fun_(k) for k in [0, _count_) in parallel and waits until all calls
+     *  have returned. _fun_ must not throw exceptions.
+     */
+    template <class Fun>
+    void run(size_t count, Fun fun) {
+      std::lock_guard<std::mutex> running(run_mutex_);   // one job at a time
+      std::function<void(size_t)> job(fun);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        count_ = count;
+        next_ = 0;
+        ++generation_;
+      }
+      cond_.notify_all();
+      size_t index = currentIndex();   // the calling thread may belong to another pool
+      currentIndex() = 0;
+      process(job, count);
+      currentIndex() = index;
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]{return active_ == 0;});
+      job_ = nullptr;
+    }
+
+  private:
+    void process(const std::function<void(size_t)>& job, size_t count) {
+      for (size_t k = next_++; k < count; k = next_++) job(k);
+    }
+
+    static size_t& currentIndex() {
+      static thread_local size_t index = 0;
+      return index;
+    }
+
+    void work(size_t index) {
+      currentIndex() = index;
+      unsigned long seen = 0;
+      while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this, seen]{return stop_ || generation_ != seen;});
+        if (stop_) return;
+        seen = generation_;
+        if (!job_) continue;   // woke up too late
+        const std::function<void(size_t)>* job = job_;
+        size_t count = count_;
+        ++active_;
+        lock.unlock();
+        process(*job, count);
+        lock.lock();
+        if (--active_ == 0) done_.notify_all();
+      }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_, run_mutex_;
+    std::condition_variable cond_, done_;
+    const std::function<void(size_t)>* job_{nullptr};
+    size_t count_{0}, active_{0};
+    std::atomic<size_t> next_{0};
+    unsigned long generation_{0};
+    bool stop_{false};
+  };
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+//
+//  lazy.hpp: must be included for using Lazy members
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_lazy_hpp
+#define jsonserial_lazy_hpp
+
+#include <atomic>
+#include <mutex>
+
+namespace jsonserial {
+
+  /** Value that is deserialized on first access.
+   * When a Lazy member is read, its JSON text is just stored (and syntax-checked)
+   * and the value is only deserialized when get() (or * or ->) is called for the first
+   * time. Lazy values that are never accessed are written back unchanged by write().
+   * This is useful for large subtrees that are seldom used.
+   *
+   * get() can be called concurrently from several threads.
+   * A lazy subtree must not refer to shared objects ("@id") that are outside this subtree.
+   *
+   * Example:
+   * @code
+   *   class Document {
+   *     Lazy<std::vector<Page>> pages;
+   *     ...
+   *   };
+   *   defclass<Document>("Document").member("pages", &Document::pages);
+   *   ...
+   *   for (auto& p : *doc.pages) ...   // pages are deserialized here
+   * @endcode
+   */
+  template <class T>
+  class Lazy {
+  public:
+    Lazy() = default;
+    Lazy(const T& value) : value_(value) {}
+
+    Lazy(const Lazy& l) {
+      std::lock_guard<std::mutex> lock(l.mutex_);
+      copy(l);
+    }
+
+    Lazy& operator=(const Lazy& l) {
+      if (this != &l) {
+        std::lock(mutex_, l.mutex_);
+        std::lock_guard<std::mutex> lock1(mutex_, std::adopt_lock), lock2(l.mutex_, std::adopt_lock);
+        copy(l);
+      }
+      return *this;
+    }
+
+    Lazy& operator=(const T& value) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      value_ = value;
+      raw_.clear();
+      loaded_ = true;
+      return *this;
+    }
+
+    /// returns the value, deserializes it if needed.
+    T& get() {parse(); return value_;}
+    const T& get() const {parse(); return value_;}
+
+    T& operator*() {return get();}
+    const T& operator*() const {return get();}
+    T* operator->() {return &get();}
+    const T* operator->() const {return &get();}
+
+    /// returns true if the value has been deserialized (or was not read from JSON).
+    bool isLoaded() const {return loaded_;}
+
+    // - - - called by JsonSerial
+
+    void readJson(JsonSerial& js, const std::string& s) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      classes_ = &js.getClasses();
+      handler_ = js.errhandler_;
+      syntax_ = js.getSyntax();
+      name_ = js.streamname_;
+      line_ = js.currentLine();
+      value_ = T();
+      raw_.clear();
+      js.readRaw(&raw_, s);
+      loaded_ = false;
+    }
+
+    void writeJson(JsonSerial& js) const {
+      if (!loaded_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!loaded_) {js.writeRaw(raw_); return;}
+      }
+      js.writeValue(value_);
+    }
+
+    static bool validateJson(JsonSerial& js, const std::string& s) {
+      return validateValue(js, static_cast<T*>(nullptr), s);
+    }
+
+  private:
+    void copy(const Lazy& l) {
+      value_ = l.value_;
+      raw_ = l.raw_;
+      classes_ = l.classes_;
+      handler_ = l.handler_;
+      syntax_ = l.syntax_;
+      name_ = l.name_;
+      line_ = l.line_;
+      loaded_ = l.loaded_.load();
+    }
+
+    void parse() const {
+      if (loaded_) return;
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (loaded_) return;
+      JsonSerial js(*classes_, handler_);
+      js.setSyntax(syntax_);
+      std::istringstream in(raw_);
+      JSONSERIAL_TRY {
+        js.reset(name_, line_, &in, nullptr);
+        std::string token, dump;
+        bool found1, found2;
+        JsonSerial::TokenScope scope{js};   // see tokenType()
+        js.readLine(token, dump, found1, found2, false);
+        if (found1 && !js.failed()) readValue(js, value_, token);
+      }
+      JSONSERIAL_CATCH(JsonError*) {}
+      raw_.clear();
+      raw_.shrink_to_fit();
+      loaded_ = true;
+    }
+
+    mutable T value_{};
+    mutable std::string raw_;
+    const JsonClasses* classes_{nullptr};
+    JsonError::Handler handler_{nullptr};
+    unsigned int syntax_{0};
+    std::string name_;
+    size_t line_{0};
+    mutable std::atomic<bool> loaded_{true};
+    mutable std::mutex mutex_;
+  };
+
+  template <class T>
+  struct has_custom_format<Lazy<T>> : std::true_type {};
+
+}
+
+#endif
@@ -32,13 +32,23 @@ namespace jsonserial {
   template<class T>
   struct JsonArrayImpl<T, typename std::enable_if<is_std_list<T>::value>::type> : public JsonArray {
     T& cont_;
+    typename T::iterator pos_;
     
-    JsonArrayImpl(T& cont) : cont_(cont) {cont_.clear();}
+    JsonArrayImpl(T& cont) : cont_(cont) {}
+    
+    void begin(JsonSerial& js) override {
+      if (!js.reuse_ && !js.patching_) cont_.clear();
+      pos_ = cont_.begin();
+    }
     
     void add(JsonSerial& js, MetaClass::Creator* cr, const std::string& s) override {
-      cont_.resize(cont_.size()+1);
+      if (pos_ == cont_.end()) pos_ = cont_.emplace(pos_);
       ObjectPtr* objptr{nullptr};
-      readArrayValue(js, cont_.back(), objptr, cr, s);
+      readArrayValue(js, *pos_++, objptr, cr, s);
+    }
+    
+    void end(JsonSerial& js) override {
+      if (!js.patching_) cont_.erase(pos_, cont_.end());   // extra elements (reuse mode)
     }
   };
   
@@ -0,0 +1,75 @@
+//
+//  rawjson.hpp: must be included for using RawJson members
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  See: https://www.telecom-paris.fr/~elc/software/jsonserial.html
+//  (C) Eric Lecolinet 2017/2019 - https://www.telecom-paris.fr/~elc
+//
+//  JsonSerial is free software; you can redistribute it and/or modify it
+//  under the terms of the GNU Lesser General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  JsonSerial is distributed in the hope that it will be useful, but WITHOUT
+//  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+//  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+//  License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License along
+//  with this program; if not, see https://www.gnu.org/licenses/lgpl-3.0.html.
+//
+
+#ifndef jsonserial_rawjson_hpp
+#define jsonserial_rawjson_hpp
+
+namespace jsonserial {
+
+  /** Opaque JSON value.
+   * A RawJson member stores the JSON text of its value as is: the value is neither
+   * tokenized nor deserialized when read, and it is written back verbatim.
+   * This is useful for passing through parts of a document that are not used.
+   * Comments (if allowed by setSyntax()) are removed from the text.
+   * An empty RawJson is written as null.
+   */
+  class RawJson {
+  public:
+    RawJson() = default;
+    RawJson(const std::string& text) : text_(text) {}
+    RawJson(std::string&& text) : text_(std::move(text)) {}
+
+    /// returns the JSON text of the value.
+    const std::string& str() const {return text_;}
+
+    /// changes the JSON text of the value (must be valid JSON).
+    void str(const std::string& text) {text_ = text;}
+
+    bool empty() const {return text_.empty();}
+    void clear() {text_.clear();}
+
+    bool operator==(const RawJson& r) const {return text_ == r.text_;}
+    bool operator!=(const RawJson& r) const {return text_ != r.text_;}
+
+    // - - - called by JsonSerial
+
+    void readJson(JsonSerial& js, const std::string& s) {
+      text_.clear();
+      js.readRaw(&text_, s);
+    }
+
+    void writeJson(JsonSerial& js) const {js.writeRaw(text_);}
+
+    static bool validateJson(JsonSerial& js, const std::string& s) {
+      validateAny(js, s);
+      return true;
+    }
+
+  private:
+    std::string text_;
+  };
+
+  template <>
+  struct has_custom_format<RawJson> : std::true_type {};
+
+}
+
+#endif
@@ -38,7 +38,10 @@ namespace jsonserial {
   : public JsonArray {
     T& set_;
     
-    JsonArrayImpl(T& set) : set_(set) {set_.clear();}
+    JsonArrayImpl(T& set) : set_(set) {}
+    
+    // elements of sets are constant and can't be reused, they are added in patch mode.
+    void begin(JsonSerial& js) override {if (!js.patching_) set_.clear();}
     
     void add(JsonSerial& js, MetaClass::Creator* cr, const std::string& s) override {
       typename T::value_type val;
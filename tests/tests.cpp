@@ -11,8 +11,14 @@
 #include "jsonserial/array.hpp"
 #include "jsonserial/deque.hpp"
 #include "jsonserial/forward_list.hpp"
+#include "jsonserial/internedstring.hpp"
+#include "jsonserial/jsonbatch.hpp"
+#include "jsonserial/jsondelta.hpp"
+#include "jsonserial/jsonjournal.hpp"
+#include "jsonserial/lazy.hpp"
 #include "jsonserial/list.hpp"
 #include "jsonserial/map.hpp"
+#include "jsonserial/rawjson.hpp"
 #include "jsonserial/unordered_set.hpp"
 #include "jsonserial/set.hpp"
 #include "jsonserial/unordered_map.hpp"
@@ -20,6 +26,16 @@
 using namespace std;
 using namespace jsonserial;
 
+// class with members that are deserialized on first access or never
+class Archive {
+public:
+  string title;
+  Lazy<std::map<string, std::vector<string>>> notes;
+  Lazy<string> comment;
+  RawJson extra;
+  JsonUnknowns others;
+};
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 // Class for serializing classes
@@ -103,17 +119,682 @@ bool test(const string& filename, const string& filename2,
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
+bool test_validate(const string& filename) {
+  cout << "\n*** Test: validate " << filename << endl;
+  int errors = 0;
+  JsonSerial js(MyClasses::instance, [&errors](const JsonError&) {++errors;});
+  
+  if (!js.validate<ContactsPtr>(filename) || errors != 0) return false;
+
+  // unknown member, unknown class, out of range, not a boolean, invalid ID
+  std::istringstream in(R"({"contacts": [
+    {"firstname1": "Bob", "nickname": "bobby", "age2": 70000, "isalive": 3},
+    {"@class": "NoSuchClass", "age2": 1},
+    "@7"
+  ]})");
+  if (js.validate<Contacts>(in) || errors != 5) return false;
+  cout << "Errors found: " << errors << endl;
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_lazy() {
+  cout << "\n*** Test: lazy and raw members" << endl;
+  JsonSerial js(MyClasses::instance);
+  Archive a;
+  std::istringstream in(R"({"title": "old", "notes": {
+    "n1": ["a \"b\" /* c */ [", "x"], // comment
+    "n2": []
+  }, "comment": "line\nline", "extra": {"a": [1, {"b": "}"}], "c" : null},
+    "version": 3, "future": {"x": ["y"]}})");
+  if (!js.read(a, in) || a.notes.isLoaded() || a.comment.isLoaded()) return false;
+  if (a.extra.str() != R"({"a": [1, {"b": "}"}], "c" : null})") return false;
+  if (a.others.get("version") != "3" || a.others.get("future") != R"({"x": ["y"]})") return false;
+
+  // unaccessed members are written back unchanged
+  std::ostringstream out1;
+  if (!js.write(a, out1)) return false;
+  if (out1.str().find("\"n2\": []") == string::npos
+      || out1.str().find("/* c */ [") == string::npos
+      || out1.str().find("// comment") != string::npos
+      || out1.str().find(R"("future": {"x": ["y"]})") == string::npos) return false;
+
+  if (a.notes->size() != 2 || (*a.notes)["n1"].size() != 2 || *a.comment != "line\nline"
+      || !a.notes.isLoaded()) return false;
+  Archive b;
+  std::istringstream in2(out1.str());
+  if (!js.read(b, in2) || b.notes->size() != 2 || (*b.notes)["n1"][0] != "a \"b\" /* c */ [")
+    return false;
+
+  // reading again into the same object doesn't duplicate unknown members
+  std::istringstream in3(out1.str());
+  std::ostringstream out2;
+  if (!js.read(b, in3) || !js.write(b, out2)) return false;
+  const string& s = out2.str();
+  return s.find("\"version\"") != string::npos && s.find("\"version\"") == s.rfind("\"version\"");
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// unordered containers of char* may not be in the same order (nor the IDs and commas)
+static std::vector<string> sortedLines(const string& json) {
+  std::vector<string> v;
+  std::istringstream in(json);
+  for (string l; std::getline(in, l); ) {
+    if (!l.empty() && l.back() == ',') l.pop_back();
+    if (l.find("\"@") == string::npos) v.push_back(l);
+  }
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+struct Shape {virtual ~Shape() {} int x{0};};
+struct Circle : Shape {int r{0};};
+struct Scene {std::vector<std::shared_ptr<Shape>> shapes;};
+
+bool test_reuse(const string& filename) {
+  cout << "\n*** Test: reuse" << endl;
+  JsonSerial js(MyClasses::instance);
+  using Data = std::map<string, std::list<std::vector<string>>>;
+  Data data;
+  std::istringstream in1(R"({"a": [["x1", "y1"], ["z1"]], "b": [], "c": [["w1"]]})");
+  if (!js.read(data, in1)) return false;
+  const string* x = data["a"].front().data();
+
+  // elements are overwritten in place, extra elements and keys are removed
+  js.setReuse();
+  std::istringstream in2(R"({"a": [["x2", "y2"]], "b": [["v2"]]})");
+  if (!js.read(data, in2)) return false;
+  js.setReuse(false);
+  if (data.size() != 2 || data["a"].size() != 1 || data["a"].front().data() != x
+      || data["a"].front()[1] != "y2" || data["b"].front().front() != "v2") return false;
+
+  // pointees are reused if they have the same class
+  JsonClasses classes;
+  classes.defclass<Shape>("Shape").member("x", &Shape::x);
+  classes.defclass<Circle>("Circle").extends<Shape>().member("r", &Circle::r);
+  classes.defclass<Scene>("Scene").member("shapes", &Scene::shapes);
+  JsonSerial js2(classes);
+  Scene scene;
+  std::istringstream in3(R"({"shapes": [{"x": 1}, {"@class": "Circle", "x": 2, "r": 3}, {"x": 4}]})");
+  if (!js2.read(scene, in3)) return false;
+  scene.shapes[2] = scene.shapes[1];   // can't be reused twice
+  Shape *p0 = scene.shapes[0].get(), *p1 = scene.shapes[1].get();
+  js2.setReuse();
+  std::istringstream in4(R"({"shapes": [{"@class": "Circle", "x": 5, "r": 6},
+    {"@class": "Circle", "x": 7, "r": 8}, {"@class": "Circle", "x": 9, "r": 10}]})");
+  if (!js2.read(scene, in4) || scene.shapes[0].get() == p0 || scene.shapes[1].get() != p1
+      || scene.shapes[2].get() == p1 || scene.shapes[1]->x != 7 || scene.shapes[2]->x != 9
+      || static_cast<Circle&>(*scene.shapes[0]).r != 6) return false;
+
+  // a shared graph of pointers is read again in place
+  JsonSerial js3(MyClasses::instance);
+  js3.setSharing(true);
+  ContactsPtr contacts, fresh;
+  if (!js3.read(contacts, filename) || !js3.read(fresh, filename)) return false;
+  Contacts* root = &*contacts;
+  js3.setReuse();
+  std::ostringstream out1, out2;
+  return js3.read(contacts, filename) && &*contacts == root
+  && js3.write(contacts, out1) && js3.write(fresh, out2)
+  && sortedLines(out1.str()) == sortedLines(out2.str());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_patch(const string& filename) {
+  cout << "\n*** Test: patch " << filename << endl;
+  JsonSerial js(MyClasses::instance);
+  js.setSharing(true);
+  ContactsPtr contacts;
+  if (!js.read(contacts, filename)) return false;
+  std::ostringstream out1;
+  if (!js.write(contacts, out1)) return false;
+
+  // changes the 1st contact, the other ones are unchanged
+  std::istringstream in(R"({"contacts": [{"@class": "PhotoContact", "firstname1": "Patched"}]})");
+  if (!js.patch(contacts, in)) return false;
+  std::ostringstream out2;
+  if (!js.write(contacts, out2)) return false;
+  return out2.str().find("\"Patched\"") != string::npos
+  && out2.str().size() == out1.str().size() + strlen("Patched") - strlen("Bessie");
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_delta(const string& filename) {
+  cout << "\n*** Test: delta " << filename << endl;
+  JsonSerial js(MyClasses::instance);
+  ContactsPtr contacts, contacts2;
+  if (!js.read(contacts, filename)) return false;
+  JsonDelta writer, reader;
+  std::ostringstream snapshot;
+  if (!writer.writeSnapshot(js, contacts, snapshot)) return false;
+  std::istringstream in(snapshot.str());
+  if (!reader.readSnapshot(js, contacts2, in)) return false;
+
+  // changes the 1st contact: only this member is written
+  std::istringstream patch(R"({"contacts": [{"@class": "PhotoContact", "firstname1": "Patched"}]})");
+  if (!js.patch(contacts, patch)) return false;
+  std::ostringstream delta;
+  if (!writer.writeDelta(js, contacts, delta) || delta.str().size() > 100) return false;
+  std::istringstream in2(delta.str());
+  if (!reader.readDelta(js, in2)) return false;
+
+  // unordered containers may be written in a different order
+  std::ostringstream out1, out2;
+  js.setSharing(true);
+  return js.write(contacts, out1) && js.write(contacts2, out2)
+  && out1.str().size() == out2.str().size() && out2.str().find("\"Patched\"") != string::npos;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_journal(const string& filename, const string& journalname) {
+  cout << "\n*** Test: journal " << journalname << endl;
+  JsonSerial js(MyClasses::instance);
+  ContactsPtr contacts, contacts2;
+  if (!js.read(contacts, filename)) return false;
+  JsonJournal writer(journalname);
+  if (!writer.write(js, contacts)) return false;   // snapshot
+
+  std::istringstream patch(R"({"contacts": [{"@class": "PhotoContact", "firstname1": "Patched"}]})");
+  if (!js.patch(contacts, patch) || !writer.write(js, contacts)) return false;   // delta
+  size_t snapshot, deltas;
+  writer.getSizes(snapshot, deltas);
+  if (deltas == 0 || deltas > 100) return false;
+
+  JsonJournal reader(journalname);
+  if (!reader.read(js, contacts2)) return false;
+  std::ostringstream out1, out2;
+  js.setSharing(true);
+  if (!js.write(contacts, out1) || !js.write(contacts2, out2)
+      || out1.str().size() != out2.str().size()) return false;
+
+  // the journal is compacted when the deltas are too large
+  writer.setRatio(0);
+  std::istringstream patch2(R"({"contacts": [{"@class": "PhotoContact", "firstname1": "Bessie"}]})");
+  if (!js.patch(contacts, patch2) || !writer.write(js, contacts)) return false;
+  writer.getSizes(snapshot, deltas);
+  if (deltas != 0 || snapshot == 0) return false;
+
+  // newlines in the strings of raw and lazy members don't split the lines of the journal
+  JsonSerial js2(MyClasses::instance);
+  js2.setSyntax(JsonSerial::Relaxed);
+  Archive a1, a2;
+  std::istringstream in("{\"title\": \"t\", \"comment\": \"a\nb\", \"extra\": {\"s\": \"c\nd\"}}");
+  JsonJournal writer2(journalname);
+  if (!js2.read(a1, in) || !writer2.write(js2, a1)) return false;   // snapshot
+  std::istringstream patch3("{\"extra\": {\"s\": \"e\nf\"}}");
+  if (!js2.patch(a1, patch3) || !writer2.write(js2, a1)) return false;   // delta
+  JsonJournal reader2(journalname);
+  std::map<string, string> extra;
+  std::istringstream in2;
+  if (!reader2.read(js2, a2)) return false;
+  in2.str(a2.extra.str());
+  return js2.read(extra, in2) && extra["s"] == "e\nf" && *a2.comment == "a\nb";
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_async(const string& filename, const string& outname) {
+  cout << "\n*** Test: async write " << outname << endl;
+  JsonSerial js(MyClasses::instance);
+  js.setSharing(true);
+  ContactsPtr contacts;
+  if (!js.read(contacts, filename)) return false;
+  std::ostringstream out;
+  if (!js.write(contacts, out)) return false;
+
+  std::future<bool> done = js.writeAsync(contacts, outname);
+  if (!done.get()) return false;
+  std::ifstream in(outname, std::ios::ate);
+  if (size_t(in.tellg()) != out.str().size()) return false;
+
+  // the copy is written with the same settings
+  js.setFingerprint();
+  if (!js.writeCopyAsync(contacts, outname).get()) return false;
+  std::ifstream in2(outname);
+  std::string line;
+  bool ok = std::getline(in2, line) && line.compare(0, 14, "// jsonserial ") == 0;
+  js.setFingerprint(false);
+  return ok && js.write(contacts, outname);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_read_ahead(const string& filename) {
+  cout << "\n*** Test: read ahead " << filename << endl;
+  JsonSerial js(MyClasses::instance);
+  js.setSharing(true);
+  ContactsPtr contacts, contacts2, contacts3;
+  std::ostringstream out1, out2, out3;
+  if (!js.read(contacts, filename) || !js.write(contacts, out1)) return false;
+
+  js.setReadAhead(4096);   // small blocks: many buffer switches
+  if (!js.read(contacts2, filename) || !js.write(contacts2, out2)) return false;
+  js.setReadAhead(0);
+
+  std::ifstream in(filename);
+  JsonReadAheadBuffer buf(in.rdbuf(), 1000);
+  std::istream input(&buf);
+  if (!js.read(contacts3, input) || !js.write(contacts3, out3)) return false;
+  return out1.str().size() == out2.str().size() && out1.str().size() == out3.str().size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_write_behind(const string& filename, const string& outname) {
+  cout << "\n*** Test: write behind " << outname << endl;
+  JsonSerial js(MyClasses::instance);
+  js.setSharing(true);
+  ContactsPtr contacts;
+  std::ostringstream out;
+  if (!js.read(contacts, filename) || !js.write(contacts, out)) return false;
+
+  js.setWriteBehind(4096);   // small blocks: the writing thread is often late
+  if (!js.write(contacts, outname)) return false;
+  std::ifstream in(outname, std::ios::ate);
+  return size_t(in.tellg()) == out.str().size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_many_files(const string& dir) {
+  cout << "\n*** Test: many files " << dir << endl;
+  JsonSerial js(MyClasses::instance);
+  std::vector<Names> names(8, Names(true)), names2(9);
+  std::vector<std::pair<const Names*, string>> out;
+  std::vector<std::pair<Names*, string>> in;
+  for (size_t k = 0; k < names.size(); ++k) {
+    out.push_back({&names[k], dir + "names" + to_string(k) + ".json"});
+    in.push_back({&names2[k], out.back().second});
+  }
+  in.push_back({&names2.back(), dir + "no-such-file.json"});
+
+  JsonThreadPool pool(4);
+  for (auto& e : js.writeMany(out, &pool)) if (e.type != JsonError::OK) return false;
+  auto results = js.readMany(in, &pool);
+  for (size_t k = 0; k < names.size(); ++k) {
+    ::remove(out[k].second.c_str());
+    if (results[k].type != JsonError::OK) return false;
+  }
+  return results.back().type == JsonError::CantReadFile;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_batch_writer() {
+  cout << "\n*** Test: batch writer" << endl;
+  std::vector<Names> names(20, Names(true));
+  std::vector<const Names*> ptrs;
+  for (auto& n : names) ptrs.push_back(&n);
+
+  JsonBatchWriter writer(MyClasses::instance, 4);
+  std::vector<JsonError> errors;
+  std::vector<string> results = writer.write(ptrs.data(), ptrs.size(), &errors);
+
+  JsonSerial js(MyClasses::instance);
+  std::ostringstream out;
+  if (!js.write(names[0], out) || results.size() != names.size()) return false;
+  for (size_t k = 0; k < results.size(); ++k) {
+    if (results[k] != out.str() || errors[k].type != JsonError::OK) return false;
+  }
+
+  // concurrent calls are executed one at a time
+  std::vector<string> results2;
+  std::thread other([&]() {results2 = writer.write(ptrs.data(), ptrs.size());});
+  results = writer.write(ptrs.data(), ptrs.size());
+  other.join();
+  return results == results2 && results[0] == out.str();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+struct Point {int x{1}, y{2};};
+
+bool test_frozen_classes() {
+  cout << "\n*** Test: frozen classes" << endl;
+  std::vector<JsonError::Type> errors;
+  JsonClasses classes([&errors](const JsonError& e) {errors.push_back(e.type);});
+  auto& point = classes.defclass<Point>("Point").member("x", &Point::x);
+  classes.freeze();
+  classes.defclass<Names>("Names");
+  point.member("y", &Point::y);
+  if (classes.getClass("Names") || errors.size() != 2 || errors[1] != JsonError::FrozenClasses)
+    return false;
+
+  std::vector<string> results(8);
+  std::vector<std::thread> threads;
+  for (auto& r : results) threads.emplace_back([&classes, &r] {
+    JsonSerial js(classes);
+    std::vector<Point> points(100);
+    std::ostringstream out;
+    std::istringstream in;
+    if (js.write(points, out)) in.str(out.str());
+    if (js.read(points, in)) r = out.str();
+  });
+  for (auto& t : threads) t.join();
+  for (auto& r : results) if (r.empty() || r != results[0]) return false;
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_session() {
+  cout << "\n*** Test: session" << endl;
+  JsonSerial js(MyClasses::instance, [](const JsonError&) {});
+  Names names(true), names2;
+  std::ostringstream out;
+  std::istringstream in;
+  string first;
+  for (int k = 0; k < 1000; ++k) {
+    out.str("");
+    if (!js.write(names, out)) return false;
+    if (k == 0) first = out.str(); else if (out.str() != first) return false;
+    in.clear();
+    in.str(out.str());
+    if (!js.read(names2, in) || js.getError()) return false;
+  }
+  // the error object is recycled
+  in.clear();
+  in.str("[1, 2");
+  if (js.read(names2, in) || !js.getError()) return false;
+  JsonError* e = js.getError();
+  in.clear();
+  in.str(first);
+  if (!js.read(names2, in) || js.getError()) return false;
+  in.clear();
+  in.str("{");
+  return !js.read(names2, in) && js.getError() == e && e->type == JsonError::ExpectingPairOrBrace;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_invalid_numbers() {
+  cout << "\n*** Test: invalid numbers" << endl;
+  JsonSerial js(MyClasses::instance, [](const JsonError&) {});
+  std::vector<int> v;
+  std::vector<double> d;
+  std::istringstream in1(R"([1, "x"])"), in2("[99999999999]"), in3("[1.5, 1e-310]");
+  if (js.read(v, in1) || js.getError()->type != JsonError::InvalidValue) return false;
+  if (js.read(v, in2) || js.getError()->type != JsonError::InvalidValue) return false;
+  if (!js.read(d, in3) || d.size() != 2 || d[0] != 1.5) return false;
+  // validate() must accept what read() accepts (1.5 is truncated) and nothing else
+  std::istringstream in4("[1.5]"), in5("[1.5]"), in6("[99999999999]");
+  if (!js.validate<std::vector<int>>(in4) || !js.read(v, in5) || v.size() != 1 || v[0] != 1
+      || js.validate<std::vector<int>>(in6)) return false;
+  // same for floats (partial and out of range numbers) and chars (the first char is kept)
+  std::vector<float> f;
+  std::vector<char> c;
+  const std::string floats = R"(["1.5x", 1e999])", chars = R"(["ab", "c"])";
+  std::istringstream in7(floats), in8(floats), in9(chars), in10(chars);
+  return js.validate<std::vector<float>>(in7) && js.read(f, in8) && f.size() == 2 && f[0] == 1.5
+  && js.validate<std::vector<char>>(in9) && js.read(c, in10) && c.size() == 2 && c[0] == 'a';
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_syntax() {
+  cout << "\n*** Test: syntax" << endl;
+  JsonSerial js(MyClasses::instance, [](const JsonError&) {});
+  std::vector<std::string> v;
+  const std::string data = "[\"a\", // comment\n b\n c]";
+  js.setSyntax(JsonSerial::Strict);
+  std::istringstream in1(data);
+  if (js.read(v, in1) || js.getError()->arg.compare(0, 2, "//") != 0) return false;
+  js.setSyntax(JsonSerial::Comments);
+  std::istringstream in2(data);
+  if (js.read(v, in2) || js.getError()->type != JsonError::InvalidValue
+      || js.getError()->arg[0] != 'b') return false;
+  js.setSyntax(JsonSerial::Relaxed);
+  std::istringstream in3(data);
+  return js.read(v, in3) && v.size() == 3 && v[1] == "b" && v[2] == "c";
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_tokens() {
+  cout << "\n*** Test: typed tokens" << endl;
+  JsonSerial js(MyClasses::instance, [](const JsonError&) {});
+  std::vector<int> v;
+  std::vector<const char*> s;
+  std::istringstream in1("[-2147483648, 2147483647, -0]"), in2("[2147483648]");
+  std::istringstream in3(R"(["null", null])"), in4(R"(["true", false])");
+  std::deque<bool> b;
+  if (!js.read(v, in1) || v[0] != std::numeric_limits<int>::min()
+      || v[1] != std::numeric_limits<int>::max() || v[2] != 0) return false;
+  if (js.read(v, in2) || js.getError()->type != JsonError::InvalidValue) return false;
+  if (!js.read(b, in4) || b.size() != 2 || !b[0] || b[1]) return false;
+  return js.read(s, in3) && s[0] && std::string(s[0]) == "null" && !s[1];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_fingerprint() {
+  cout << "\n*** Test: fingerprint" << endl;
+  JsonClasses classes1, classes2;
+  classes1.defclass<Point>("Point").member("x", &Point::x).member("y", &Point::y);
+  auto& point2 = classes2.defclass<Point>("Point").member("x", &Point::x);
+  if (classes1.fingerprint() == classes2.fingerprint()) return false;
+  struct Point2 {std::string x; int y;};   // same names, other type
+  JsonClasses classes3;
+  classes3.defclass<Point2>("Point").member("x", &Point2::x).member("y", &Point2::y);
+  if (classes1.fingerprint() == classes3.fingerprint()) return false;
+  JsonSerial js1(classes1), js2(classes2, [](const JsonError&) {});
+  js1.setFingerprint();
+  js2.setFingerprint();
+  std::vector<Point> points(2), points2;
+  points[1].x = 5;
+  std::ostringstream out;
+  std::istringstream in;
+  if (!js1.write(points, out) || out.str().compare(0, 14, "// jsonserial ") != 0) return false;
+  in.str(out.str());
+  if (!js1.read(points2, in) || points2.size() != 2 || points2[1].x != 5) return false;
+  
+  // unquoted strings are not checked in trusted files
+  std::string header = out.str().substr(0, out.str().find('\n')+1);
+  std::vector<std::string> v;
+  std::istringstream in1(header + "[abc]"), in2(header + "[abc]");
+  if (!js1.read(v, in1) || v.size() != 1 || v[0] != "abc") return false;
+  if (js2.read(v, in2) || js2.getError()->type != JsonError::InvalidValue) return false;
+
+  // only the header is skipped, other comments are errors with the Strict syntax
+  JsonSerial js3(classes1, [](const JsonError&) {});
+  js3.setFingerprint();
+  js3.setSyntax(JsonSerial::Strict);
+  std::istringstream in3(header + "[\"abc\"]"), in4("// jsonserial\n[\"abc\"]");
+  if (!js3.read(v, in3) || v.size() != 1 || js3.read(v, in4)) return false;
+
+  // the fingerprint is computed again if the classes are modified
+  point2.member("y", &Point::y);
+  return classes1.fingerprint() == classes2.fingerprint();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_error_log() {
+  cout << "\n*** Test: error log" << endl;
+  JsonSerial js(MyClasses::instance);
+  auto log = make_shared<JsonErrorLog>(2);
+  js.setErrorLog(log);
+  std::vector<Names> v;
+  const char data[] = R"([{"foo": 1}, {"foo": 2}, {"bar": 3}, {"baz": 4}, {"foo": 5}])";
+  JsonInputBuffer buf(data, sizeof(data)-1);
+  std::istream in(&buf);
+  if (js.read(v, in) || v.size() != 5 || log->size() != 2 || log->dropped() != 1) return false;
+  const JsonError& e = log->error(0);
+  if (e.type != JsonError::UnknownMember || e.member != "foo" || e.classname != "Names"
+      || log->count(0) != 3 || e.offset != 10 || log->error(1).member != "bar") return false;
+  std::ostringstream out;
+  log->print(out);
+  if (out.str().find("unknown member 'foo' in class 'Names'\n  (3 times)") == string::npos)
+    return false;
+
+  // lines and columns are computed from the buffer of the stream if possible
+  struct NoSeekBuffer : std::streambuf {
+    std::string data_{"[\n  1,\n  2x,\n  3\n]"};
+    NoSeekBuffer() {setg(&data_[0], &data_[0], &data_[0] + data_.size());}
+  } buf2;
+  log->clear();
+  std::vector<int> v2;
+  std::istream in2(&buf2);
+  if (js.read(v2, in2)) return false;
+  const JsonError& e2 = log->error(0);
+  if (e2.line != 3 || e2.column != 6 || e2.offset != 12) return false;
+
+  // otherwise by repositioning the stream, the line is unknown if it can't be repositioned
+  struct ChunkBuffer : std::streambuf {
+    std::string data_{"[\n  1,\n  2x,\n  3\n]"};
+    bool seekable_;
+    ChunkBuffer(bool seekable) : seekable_(seekable) {setg(&data_[0], &data_[0], &data_[0]);}
+    int_type underflow() override {
+      char *begin = &data_[0], *end = begin + data_.size(), *p = gptr();
+      if (p == end) return traits_type::eof();
+      setg(p > begin ? p-1 : p, p, std::min(p+2, end));  // 2 chars, 1 can be put back
+      return traits_type::to_int_type(*p);
+    }
+    pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode m) override {
+      off_type base = dir == std::ios::beg ? 0 : dir == std::ios::cur ? gptr()-&data_[0] : data_.size();
+      return seekpos(base + off, m);
+    }
+    pos_type seekpos(pos_type pos, std::ios::openmode) override {
+      if (!seekable_ || pos < 0 || off_type(pos) > off_type(data_.size())) return pos_type(off_type(-1));
+      char* p = &data_[0] + off_type(pos);
+      setg(p, p, p);
+      return pos;
+    }
+  };
+  for (bool seekable : {true, false}) {
+    ChunkBuffer buf3(seekable);
+    log->clear();
+    std::istream in3(&buf3);
+    if (js.read(v2, in3)) return false;
+    const JsonError& e3 = log->error(0);
+    if (e3.offset != 12 || e3.line != (seekable ? 3 : 0) || e3.column != (seekable ? 6 : 0)) return false;
+  }
+  
+  // errors are counted by type, class and member, the first argument is kept
+  log->clear();
+  std::istringstream in3(R"([1, "x", "y"])");
+  return !js.validate<std::vector<int>>(in3) && log->size() == 1 && log->count(0) == 2
+    && log->error(0).arg.compare(0, 1, "x") == 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool test_string_buffer() {
+  cout << "\n*** Test: string buffer" << endl;
+  JsonSerial js(MyClasses::instance);
+  auto strings = make_shared<JsonStringBuffer>();
+  js.setStringBuffer(strings);
+
+  const char data[] = R"(["home", "work", null, "a\"b"])";
+  JsonInputBuffer buf(data, sizeof(data)-1);
+  std::istream in(&buf);
+  std::vector<const char*> v;
+  if (!js.read(v, in) || v.size() != 4 || strcmp(v[0], "home") || v[2] != nullptr
+      || strcmp(v[3], "a\"b") || strings->blockCount() != 1) return false;
+
+  // identical values share the same storage
+  js.setStringBuffer(make_shared<JsonStringBuffer>(true));
+  std::istringstream in2(R"(["home", "work", "home", "home"])");
+  std::vector<InternedString> v2;
+  if (!js.read(v2, in2) || v2.size() != 4 || v2[0] != "home" || v2[0].c_str() != v2[3].c_str()
+      || js.getStringBuffer()->internedCount() != 2) return false;
+
+  // only strings can be read or validated as interned strings
+  JsonSerial js2(MyClasses::instance, [](const JsonError&) {});
+  js2.setStringBuffer(make_shared<JsonStringBuffer>(true));
+  for (const char* data : {"[null]", "[12]", "[true]", "[{}]", "[[]]"}) {
+    std::istringstream in3(data), in4(data);
+    if (js2.read(v2, in3) || js2.getError()->type != JsonError::InvalidValue
+        || js2.validate<std::vector<InternedString>>(in4)) return false;
+  }
+  std::istringstream in5(R"(["home"])");
+  return js2.validate<std::vector<InternedString>>(in5);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static int arena_nodes{0};
+
+struct ArenaNode {
+  std::shared_ptr<ArenaNode> next;
+  ArenaNode() {++arena_nodes;}
+  ~ArenaNode() {--arena_nodes;}
+};
+
+bool test_arena(const string& filename) {
+  cout << "\n*** Test: arena " << filename << endl;
+  // objects containing shared_ptrs must not keep the arena alive
+  JsonClasses classes;
+  classes.defclass<ArenaNode>("ArenaNode").member("next", &ArenaNode::next);
+  std::weak_ptr<JsonArena> weak;
+  {
+    auto arena = make_shared<JsonArena>();
+    weak = arena;
+    JsonSerial js(classes);
+    js.setArena(arena);
+    ArenaNode* node{nullptr};
+    std::istringstream in(R"({"next": {"next": null}})");
+    if (!js.read(node, in) || !node->next || arena_nodes != 2) return false;
+  }
+  if (!weak.expired() || arena_nodes != 0) return false;
+
+  auto arena = make_shared<JsonArena>();   // must outlive the objects
+  JsonSerial js(MyClasses::instance);
+  js.setSharing(true);
+  ContactsPtr copy1, copy2;
+  if (!js.read(copy1, filename)) return false;
+
+  js.setArena(arena);
+  if (!js.read(copy2, filename) || !arena->contains(&*copy2)) return false;
+  js.setArena(nullptr);
+
+  std::ostringstream out1, out2;
+  if (!js.write(copy1, out1) || !js.write(copy2, out2)) return false;
+  return sortedLines(out1.str()) == sortedLines(out2.str());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
 int main(int argc, char** argv) {  
   string dir = (argc > 1) ? argv[1] : "/tmp/";
   
   int count = 100;
+  bool ok = true;
 
   // test without sharing objects
-  test(dir+"contacts.json", dir+"contacts-copy.json", count, false, false);
+  ok &= test(dir+"contacts.json", dir+"contacts-copy.json", count, false, false);
   
   // test with shared objects + cyclic graph
-  test(dir+"contacts-shared.json", dir+"contacts-shared-copy.json", count, true, false);
-  return 0;
+  ok &= test(dir+"contacts-shared.json", dir+"contacts-shared-copy.json", count, true, false);
+
+  ok &= test_validate(dir+"contacts-shared.json");
+  ok &= test_arena(dir+"contacts-shared.json");
+  ok &= test_reuse(dir+"contacts-shared.json");
+  ok &= test_patch(dir+"contacts.json");
+  ok &= test_delta(dir+"contacts-shared.json");
+  ok &= test_journal(dir+"contacts-shared.json", dir+"contacts.journal");
+  ok &= test_async(dir+"contacts-shared.json", dir+"contacts-async.json");
+  ok &= test_read_ahead(dir+"contacts-shared.json");
+  ok &= test_write_behind(dir+"contacts-shared.json", dir+"contacts-behind.json");
+  ok &= test_many_files(dir);
+  ok &= test_batch_writer();
+  ok &= test_frozen_classes();
+  ok &= test_session();
+  ok &= test_invalid_numbers();
+  ok &= test_syntax();
+  ok &= test_tokens();
+  ok &= test_fingerprint();
+  ok &= test_error_log();
+  ok &= test_lazy();
+  ok &= test_string_buffer();
+
+  cout << (ok ? "\nAll tests passed" : "\nSome tests FAILED") << endl;
+  return ok ? 0 : 1;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -139,6 +820,13 @@ MyClasses::MyClasses()
   .member("value3", &Note::value3)
   .member("value4", &Note::value4);
 
+  defclass<Archive>("Archive")
+  .member("title", &Archive::title)
+  .member("notes", &Archive::notes)
+  .member("comment", &Archive::comment)
+  .member("extra", &Archive::extra)
+  .unknowns(&Archive::others);
+
   defclass<Contact::Address>("Contact::Address")
   .member("street", &Contact::Address::street)
   .member("city", &Contact::Address::city)
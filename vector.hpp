@@ -36,38 +36,24 @@ namespace jsonserial {
   template<class T>
   struct JsonArrayImpl<T, typename std::enable_if<is_std_vector<T>::value>::type> : public JsonArray {
     T& cont_;
-    struct Ptr {size_t index; ObjectPtr* jsp;};
-    std::vector<Ptr> pointers_;
+    size_t index_{0};
     
-    JsonArrayImpl(T& cont) : cont_(cont) {cont_.clear();}
+    JsonArrayImpl(T& cont) : cont_(cont) {}
     
-    void add(JsonSerial& js, MetaClass::Creator* cr, const std::string& s) override {
-      cont_.resize(cont_.size()+1);
-      ObjectPtr* objptr{nullptr};
-      readArrayValue(js, cont_.back(), objptr, cr, s);
-      
-      // TO BE COMPLETED : shared pointers not fixed when elements in this vector point
-      // to an element that was created in this vector
-      if (objptr && objptr->init_) {
-        pointers_.push_back(Ptr{cont_.size()-1, objptr});
-      }
+    void begin(JsonSerial& js) override {
+      if (!js.reuse_ && !js.patching_) cont_.clear();
     }
     
-    void end(JsonSerial&) override {
-      cont_.shrink_to_fit();
-      if (pointers_.size() > 1) fixPointers<T>(cont_, pointers_);
+    void add(JsonSerial& js, MetaClass::Creator* cr, const std::string& s) override {
+      if (index_ >= cont_.size()) cont_.resize(index_+1);
+      ObjectPtr* objptr{nullptr};
+      readArrayValue(js, cont_[index_++], objptr, cr, s);
     }
     
-    template<class C>
-    static void fixPointers(typename std::enable_if<!is_smart_ptr<typename C::value_type>::value,C>::type &,
-                            std::vector<Ptr> &) {}
-    
-    template<class C>
-    static void fixPointers(typename std::enable_if<is_smart_ptr<typename C::value_type>::value,C>::type & cont,
-                            std::vector<Ptr> & pointers) {
-      for (auto& it : pointers) {
-        it.jsp->shared_ = &cont[it.index];
-      }
+    void end(JsonSerial& js) override {
+      if (js.patching_) return;
+      if (!js.reuse_) cont_.shrink_to_fit();
+      else if (index_ < cont_.size()) cont_.erase(cont_.begin() + index_, cont_.end());
     }
   };
   